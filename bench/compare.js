@@ -0,0 +1,39 @@
+// Compares two result files from run.js: node bench/compare.js base.json head.json
+// Prints the ops/sec and p99 change for every measurement present in both.
+
+const fs = require('fs');
+
+const [basePath, headPath] = process.argv.slice(2);
+if (!basePath || !headPath) {
+  console.error('Usage: node bench/compare.js <base.json> <head.json>');
+  process.exit(1);
+}
+
+function index(file) {
+  const report = JSON.parse(fs.readFileSync(file, 'utf8'));
+  const map = new Map();
+  for (const result of report.results) {
+    if (result.supported) {
+      map.set(`${result.target} ${result.op} ${result.corpus}`, result);
+    }
+  }
+  return map;
+}
+
+function change(base, head) {
+  const pct = ((head - base) / base) * 100;
+  return `${pct >= 0 ? '+' : ''}${pct.toFixed(1)}%`;
+}
+
+const base = index(basePath);
+const head = index(headPath);
+
+console.log(`${'measurement'.padEnd(32)} ${'ops/s'.padStart(10)} ${'p99'.padStart(10)} ${'heap'.padStart(10)}`);
+for (const [key, h] of head) {
+  const b = base.get(key);
+  if (!b) continue;
+  console.log(
+    `${key.padEnd(32)} ${change(b.opsPerSec, h.opsPerSec).padStart(10)} ` +
+    `${change(b.p99Ms, h.p99Ms).padStart(10)} ${change(b.heapBytes, h.heapBytes).padStart(10)}`
+  );
+}
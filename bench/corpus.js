@@ -0,0 +1,96 @@
+// Benchmark inputs. Small and medium queries are fixed; huge ones are built
+// deterministically so every run measures exactly the same text.
+
+const small = [
+  'SELECT 1',
+  'SELECT * FROM users WHERE id = $1',
+  "UPDATE accounts SET balance = balance - 100 WHERE id = 42",
+  "INSERT INTO events (kind, payload) VALUES ('login', '{}')",
+  'DELETE FROM sessions WHERE expires_at < now()'
+];
+
+const medium = [
+  `SELECT u.id, u.email, count(o.id) AS orders, sum(o.total) AS spent
+     FROM users u
+     LEFT JOIN orders o ON o.user_id = u.id AND o.status IN ('paid', 'shipped')
+    WHERE u.created_at >= now() - interval '30 days'
+      AND u.email NOT LIKE '%@example.com'
+    GROUP BY u.id, u.email
+   HAVING count(o.id) > 2
+    ORDER BY spent DESC NULLS LAST
+    LIMIT 50 OFFSET $1`,
+  `WITH RECURSIVE tree(id, parent_id, depth, path) AS (
+     SELECT id, parent_id, 0, ARRAY[id] FROM categories WHERE parent_id IS NULL
+     UNION ALL
+     SELECT c.id, c.parent_id, t.depth + 1, t.path || c.id
+       FROM categories c JOIN tree t ON c.parent_id = t.id
+      WHERE NOT c.id = ANY(t.path)
+   )
+   SELECT id, depth, array_to_string(path, '/') FROM tree ORDER BY path`,
+  `INSERT INTO inventory (sku, warehouse_id, quantity, updated_at)
+   SELECT s.sku, w.id, coalesce(s.qty, 0), now()
+     FROM staging s CROSS JOIN LATERAL (SELECT id FROM warehouses WHERE code = s.wh LIMIT 1) w
+   ON CONFLICT (sku, warehouse_id) DO UPDATE
+      SET quantity = inventory.quantity + excluded.quantity, updated_at = excluded.updated_at
+   RETURNING sku, quantity`,
+  `CREATE TABLE IF NOT EXISTS audit_log (
+     id bigserial PRIMARY KEY,
+     actor_id integer REFERENCES users (id) ON DELETE SET NULL,
+     action text NOT NULL CHECK (action <> ''),
+     details jsonb DEFAULT '{}'::jsonb,
+     created_at timestamptz NOT NULL DEFAULT now()
+   ) PARTITION BY RANGE (created_at)`
+];
+
+function buildHugeSelect() {
+  const columns = [];
+  for (let i = 0; i < 400; i++) {
+    columns.push(`CASE WHEN t.c${i} > ${i} THEN t.c${i} * ${i + 1} ELSE coalesce(t.d${i}, '${'x'.repeat(i % 17)}') END AS r${i}`);
+  }
+  const values = [];
+  for (let i = 0; i < 2000; i++) {
+    values.push(String(i * 7));
+  }
+  return `SELECT ${columns.join(',\n  ')}\nFROM wide_table t\nWHERE t.id IN (${values.join(', ')})`;
+}
+
+function buildHugeUnion() {
+  const parts = [];
+  for (let i = 0; i < 300; i++) {
+    parts.push(`SELECT ${i} AS n, name, upper(name) FROM t${i % 13} WHERE k = ${i} AND name ILIKE 'p${i}%'`);
+  }
+  return parts.join('\nUNION ALL\n');
+}
+
+const huge = [buildHugeSelect(), buildHugeUnion()];
+
+function plpgsqlFunction(name, statements) {
+  const body = [];
+  for (let i = 0; i < statements; i++) {
+    body.push(`  IF v_count > ${i} THEN
+    UPDATE counters SET value = value + ${i} WHERE id = v_id;
+    v_total := v_total + ${i};
+  ELSE
+    RAISE NOTICE 'branch % of ${name}', ${i};
+  END IF;`);
+  }
+  return `CREATE OR REPLACE FUNCTION ${name}(v_id integer, v_count integer) RETURNS integer AS $$
+DECLARE
+  v_total integer := 0;
+BEGIN
+${body.join('\n')}
+  RETURN v_total;
+END;
+$$ LANGUAGE plpgsql;`;
+}
+
+const plpgsql = {
+  small: [plpgsqlFunction('f_small', 1)],
+  medium: [plpgsqlFunction('f_medium', 20)],
+  huge: [plpgsqlFunction('f_huge', 500)]
+};
+
+module.exports = {
+  sql: { small, medium, huge },
+  plpgsql
+};
@@ -0,0 +1,105 @@
+// Measures one operation against one build in a fresh process, so the WASM
+// heap size it reports belongs to that operation alone. Spawned by run.js;
+// prints a JSON array of results on stdout.
+
+const path = require('path');
+const { performance } = require('perf_hooks');
+const corpus = require('./corpus');
+
+// Capture the module's linear memory as it is instantiated
+const memories = [];
+const instantiate = WebAssembly.instantiate;
+WebAssembly.instantiate = async function (...args) {
+  const result = await instantiate.apply(this, args);
+  const instance = result.instance || result;
+  for (const value of Object.values(instance.exports)) {
+    if (value instanceof WebAssembly.Memory) {
+      memories.push(value);
+    }
+  }
+  return result;
+};
+
+function heapBytes() {
+  return memories.reduce((total, memory) => total + memory.buffer.byteLength, 0);
+}
+
+function percentile(sorted, p) {
+  const index = Math.min(sorted.length - 1, Math.ceil((p / 100) * sorted.length) - 1);
+  return sorted[Math.max(0, index)];
+}
+
+// Each op maps to an input set and a function of one input
+function operations(lib) {
+  const sqlInputs = corpus.sql;
+  const ops = {
+    parse: { inputs: sqlInputs, run: (q) => lib.parse(q) },
+    parseSync: { inputs: sqlInputs, run: (q) => lib.parseSync(q) },
+    deparse: {
+      inputs: sqlInputs,
+      prepare: (q) => lib.parseSync(q),
+      run: (tree) => lib.deparse(tree)
+    },
+    fingerprint: { inputs: sqlInputs, run: (q) => lib.fingerprint(q) },
+    normalize: { inputs: sqlInputs, run: (q) => lib.normalize(q) },
+    scan: { inputs: sqlInputs, run: (q) => lib.scan(q) },
+    parsePlPgSQL: { inputs: corpus.plpgsql, run: (q) => lib.parsePlPgSQL(q) }
+  };
+  return ops;
+}
+
+async function measure({ target, entry, op, timeMs, warmupMs }) {
+  const lib = require(path.resolve(entry));
+  await lib.loadModule();
+
+  const spec = operations(lib)[op];
+  if (!spec || typeof lib[op] !== 'function') {
+    return [{ target, op, supported: false }];
+  }
+
+  const results = [];
+  for (const [size, queries] of Object.entries(spec.inputs)) {
+    const inputs = spec.prepare ? queries.map(spec.prepare) : queries;
+
+    // Warm up, then time individual calls round-robin over the inputs
+    const warmupEnd = performance.now() + warmupMs;
+    for (let i = 0; performance.now() < warmupEnd; i++) {
+      await spec.run(inputs[i % inputs.length]);
+    }
+
+    const latencies = [];
+    const start = performance.now();
+    const end = start + timeMs;
+    for (let i = 0; i < 5 || performance.now() < end; i++) {
+      const t0 = performance.now();
+      await spec.run(inputs[i % inputs.length]);
+      latencies.push(performance.now() - t0);
+    }
+    const elapsed = performance.now() - start;
+
+    latencies.sort((a, b) => a - b);
+    results.push({
+      target,
+      op,
+      corpus: size,
+      supported: true,
+      iterations: latencies.length,
+      opsPerSec: latencies.length / (elapsed / 1000),
+      meanMs: latencies.reduce((a, b) => a + b, 0) / latencies.length,
+      p50Ms: percentile(latencies, 50),
+      p99Ms: percentile(latencies, 99),
+      // Linear memory never shrinks, so this is the peak reached so far
+      heapBytes: heapBytes()
+    });
+  }
+  return results;
+}
+
+measure(JSON.parse(process.argv[2]))
+  .then((results) => {
+    process.stdout.write(JSON.stringify(results));
+  })
+  .catch((error) => {
+    console.error(error);
+    process.exit(1);
+  });
@@ -0,0 +1,121 @@
+// Runs the benchmark matrix (builds x operations x corpus sizes) and writes
+// the results as JSON. See README.md for options.
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { execFileSync } = require('child_process');
+
+const ROOT = path.join(__dirname, '..');
+
+const TARGETS = {
+  full: 'full/wasm/index.cjs',
+  'full-speed': 'full/wasm/speed/index.cjs',
+  'full-simd': 'full/wasm/simd/index.cjs',
+  'full-size': 'full/wasm/size/index.cjs',
+  v13: 'versions/13/wasm/index.cjs',
+  v14: 'versions/14/wasm/index.cjs',
+  v15: 'versions/15/wasm/index.cjs',
+  v16: 'versions/16/wasm/index.cjs',
+  v17: 'versions/17/wasm/index.cjs'
+};
+
+const OPS = ['parse', 'parseSync', 'deparse', 'fingerprint', 'normalize', 'scan', 'parsePlPgSQL'];
+
+function parseArgs(argv) {
+  const options = {
+    targets: Object.keys(TARGETS),
+    ops: OPS,
+    timeMs: 1000,
+    warmupMs: 200,
+    out: path.join(__dirname, 'results', `bench-${new Date().toISOString().replace(/[:.]/g, '-')}.json`)
+  };
+  for (let i = 0; i < argv.length; i++) {
+    const [flag, value] = argv[i].includes('=') ? argv[i].split('=') : [argv[i], argv[++i]];
+    switch (flag) {
+      case '--targets': options.targets = value.split(','); break;
+      case '--ops': options.ops = value.split(','); break;
+      case '--time': options.timeMs = Number(value); break;
+      case '--warmup': options.warmupMs = Number(value); break;
+      case '--out': options.out = path.resolve(value); break;
+      default:
+        console.error(`Unknown option: ${flag}`);
+        process.exit(1);
+    }
+  }
+  return options;
+}
+
+function packageVersion(entry) {
+  // Build profiles live one directory further down, in wasm/<profile>/
+  for (let dir = path.dirname(path.join(ROOT, entry)); dir.startsWith(ROOT + path.sep); dir = path.dirname(dir)) {
+    const packageJson = path.join(dir, 'package.json');
+    if (fs.existsSync(packageJson)) {
+      return require(packageJson).version;
+    }
+  }
+  return null;
+}
+
+function gitCommit() {
+  try {
+    return execFileSync('git', ['rev-parse', 'HEAD'], { cwd: ROOT }).toString().trim();
+  } catch (e) {
+    return null;
+  }
+}
+
+function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const results = [];
+  const targets = {};
+
+  for (const target of options.targets) {
+    const entry = TARGETS[target];
+    if (!entry) {
+      console.error(`Unknown target: ${target}. Known targets: ${Object.keys(TARGETS).join(', ')}`);
+      process.exit(1);
+    }
+    if (!fs.existsSync(path.join(ROOT, entry))) {
+      console.log(`Skipping ${target}: ${entry} not built`);
+      continue;
+    }
+    targets[target] = { entry, version: packageVersion(entry) };
+
+    for (const op of options.ops) {
+      const args = JSON.stringify({ target, entry: path.join(ROOT, entry), op, timeMs: options.timeMs, warmupMs: options.warmupMs });
+      const output = execFileSync(process.execPath, [path.join(__dirname, 'measure.js'), args], { maxBuffer: 16 * 1024 * 1024 });
+      for (const result of JSON.parse(output.toString())) {
+        results.push(result);
+        if (result.supported) {
+          console.log(
+            `${target.padEnd(5)} ${op.padEnd(13)} ${result.corpus.padEnd(7)} ` +
+            `${result.opsPerSec.toFixed(0).padStart(9)} ops/s  ` +
+            `p50 ${result.p50Ms.toFixed(3).padStart(8)} ms  p99 ${result.p99Ms.toFixed(3).padStart(8)} ms  ` +
+            `heap ${(result.heapBytes / 1024 / 1024).toFixed(1)} MB`
+          );
+        }
+      }
+    }
+  }
+
+  const report = {
+    meta: {
+      date: new Date().toISOString(),
+      commit: gitCommit(),
+      node: process.version,
+      platform: `${os.platform()}-${os.arch()}`,
+      cpu: os.cpus()[0] ? os.cpus()[0].model : null,
+      timeMs: options.timeMs,
+      warmupMs: options.warmupMs
+    },
+    targets,
+    results
+  };
+
+  fs.mkdirSync(path.dirname(options.out), { recursive: true });
+  fs.writeFileSync(options.out, JSON.stringify(report, null, 2) + '\n');
+  console.log(`\nWrote ${path.relative(process.cwd(), options.out)}`);
+}
+
+main();
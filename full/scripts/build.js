@@ -23,11 +23,15 @@ fs.renameSync(
   path.join(wasmDir, 'index.cjs')
 );
 
-// Rename ESM files
-fs.renameSync(
-  path.join(esmDir, 'index.js'),
-  path.join(wasmDir, 'index.js')
-);
+// Rename ESM files, giving the ES module build the URL it locates
+// libpg-query.wasm by (see compileWasm in src/index.ts)
+const esmSource = fs.readFileSync(path.join(esmDir, 'index.js'), 'utf8');
+const esmModuleUrl = 'const ESM_MODULE_URL = undefined;';
+if (!esmSource.includes(esmModuleUrl)) {
+  throw new Error(`${esmModuleUrl} not found in the ES module build`);
+}
+fs.writeFileSync(path.join(wasmDir, 'index.js'), esmSource.replace(esmModuleUrl, 'const ESM_MODULE_URL = import.meta.url;'));
+fs.unlinkSync(path.join(esmDir, 'index.js'));
 
 // Rename declaration files
 fs.renameSync(
@@ -35,4 +39,19 @@ fs.renameSync(
   path.join(wasmDir, 'index.d.ts')
 );
 
+// Give each build profile in wasm/<profile>/ (see PROFILE in the Makefile) its
+// own entry points next to its libpg-query.js
+for (const profile of fs.readdirSync(wasmDir)) {
+  const profileDir = path.join(wasmDir, profile);
+  if (!fs.existsSync(path.join(profileDir, 'libpg-query.js'))) continue;
+
+  for (const file of ['index.cjs', 'index.js', 'index.d.ts']) {
+    const source = fs.readFileSync(path.join(wasmDir, file), 'utf8');
+    fs.writeFileSync(path.join(profileDir, file), source
+      .replace(/(['"])\.\.\/proto-schema\.js\1/g, '$1../../proto-schema.js$1')
+      .replace(/(['"])\.\.\/native\1/g, '$1../../native$1'));
+  }
+  console.log(`Packaged build profile: ${profile}`);
+}
+
 console.log('Build completed successfully!'); 
\ No newline at end of file
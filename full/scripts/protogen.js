@@ -1,4 +1,5 @@
-const { exec } = require('child_process');
+const fs = require('fs');
+const path = require('path');
 
 // IMPORTANT — SEE ISSUE: https://github.com/launchql/libpg-query-node/issues/92
 
@@ -6,35 +7,20 @@ const { exec } = require('child_process');
 const branchName = '17-6.1.0';
 const protoUrl = `https://raw.githubusercontent.com/pganalyze/libpg_query/${branchName}/protobuf/pg_query.proto`;
 const inFile = 'libpg_query/protobuf/pg_query.proto';
-const outFile = 'proto.js';
 
-const protogenCmd = [
-  'pg-proto-parser',
-  'protogen',
-  '--protoUrl',
-  protoUrl,
-  '--inFile',
-  inFile,
-  '--outFile',
-  outFile,
-  '--originalPackageName',
-  'protobufjs/minimal',
-  '--newPackageName',
-  '@launchql/protobufjs/minimal'
-];
-
-// Step 2: Generate proto.js using pbjs (Assuming pbjs is installed and accessible)
-function generateProtoJS(callback) {
-  exec(protogenCmd.join(' '), (error, stdout, stderr) => {
-    if (error) {
-      console.error(`Error during code generation: ${error.message}`);
-      return;
-    }
-    console.log('Generated proto.js from proto file.');
-    callback();
-  });
+// Fetches pg_query.proto for scripts/protoschema.js, which generates the field
+// table src/index.ts encodes and decodes parse trees with
+async function downloadProto() {
+  const response = await fetch(protoUrl);
+  if (!response.ok) {
+    throw new Error(`Failed to download ${protoUrl}: ${response.status} ${response.statusText}`);
+  }
+  fs.mkdirSync(path.dirname(inFile), { recursive: true });
+  fs.writeFileSync(inFile, await response.text());
+  console.log(`Downloaded ${inFile}`);
 }
 
-  generateProtoJS(() => {
-    console.log('all done 🎉');
-  });
\ No newline at end of file
+downloadProto().catch((error) => {
+  console.error(`Error downloading the proto file: ${error.message}`);
+  process.exit(1);
+});
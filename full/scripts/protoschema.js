@@ -0,0 +1,66 @@
+const fs = require('fs');
+const path = require('path');
+
+// Generates proto-schema.js: a compact field table for every message and enum in
+// pg_query.proto. src/index.ts uses it to decode and encode parse trees directly
+// from the protobuf wire format, without going through protobufjs message objects.
+
+// Configuration Variables
+const inFile = process.argv[2] || 'libpg_query/protobuf/pg_query.proto';
+const outFile = process.argv[3] || 'proto-schema.js';
+
+const BLOCK_RE = /\b(message|enum)\s+(\w+)\s*\{((?:[^{}]|\{[^{}]*\})*)\}/g;
+const FIELD_RE = /(repeated\s+)?([\w.]+)\s+(\w+)\s*=\s*(\d+)\s*(?:\[\s*json_name\s*=\s*"(\w+)"\s*\])?\s*;/g;
+const ENUM_VALUE_RE = /(\w+)\s*=\s*(-?\d+)\s*;/g;
+
+function parseProto(source) {
+  const messages = {};
+  const enums = {};
+
+  source = source
+    .replace(/\/\*[\s\S]*?\*\//g, '')
+    .replace(/\/\/.*$/gm, '');
+
+  for (const [, kind, name, body] of source.matchAll(BLOCK_RE)) {
+    if (kind === 'message') {
+      // [field number, AST key (json_name if set), type, repeated]
+      messages[name] = [...body.matchAll(FIELD_RE)].map(
+        ([, repeated, type, fieldName, number, jsonName]) =>
+          [Number(number), jsonName || fieldName, type, repeated ? 1 : 0]
+      );
+    } else {
+      enums[name] = {};
+      for (const [, valueName, value] of body.matchAll(ENUM_VALUE_RE)) {
+        enums[name][value] = valueName;
+      }
+    }
+  }
+
+  return { messages, enums };
+}
+
+function generateSchema() {
+  const { messages, enums } = parseProto(fs.readFileSync(inFile, 'utf8'));
+
+  const lines = [
+    `// Generated by scripts/protoschema.js from ${path.basename(inFile)}. Do not edit.`,
+    'module.exports = {',
+    '  messages: {',
+    Object.entries(messages)
+      .map(([name, fields]) => `    ${JSON.stringify(name)}: ${JSON.stringify(fields)}`)
+      .join(',\n'),
+    '  },',
+    '  enums: {',
+    Object.entries(enums)
+      .map(([name, values]) => `    ${JSON.stringify(name)}: ${JSON.stringify(values)}`)
+      .join(',\n'),
+    '  }',
+    '};',
+    ''
+  ];
+
+  fs.writeFileSync(outFile, lines.join('\n'));
+  console.log(`Generated ${outFile} (${Object.keys(messages).length} messages, ${Object.keys(enums).length} enums).`);
+}
+
+generateSchema();
@@ -0,0 +1,107 @@
+#include "pg_query.h"
+#include "pg_query_internal.h"
+#include "pg_query_outfuncs.h"
+#include "wasm_wrapper.h"
+
+#include "utils/memutils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Fused analysis: the outputs selected by `flags` (ANALYZE_*) for one input,
+// from a single raw parse. The tree is serialized with pg_query_nodes_to_json as
+// pg_query_parse does, and walked by libpg_query's own fingerprint and normalize
+// code (analyze_fingerprint.c, analyze_normalize.c), so every output matches
+// the one from the separate call. Only the scan reads the text again.
+
+static PgQueryError* analyze_error(char* message) {
+    PgQueryError* error = (PgQueryError*)calloc(1, sizeof(PgQueryError));
+    if (error) {
+        error->message = message ? message : strdup("Memory allocation failed");
+    } else {
+        free(message);
+    }
+    return error;
+}
+
+EMSCRIPTEN_KEEPALIVE
+WasmAnalyzeResult* wasm_analyze(const char* input, int flags) {
+    WasmAnalyzeResult* result = (WasmAnalyzeResult*)calloc(1, sizeof(WasmAnalyzeResult));
+    if (!result) {
+        return NULL;
+    }
+    if (!input || !*input) {
+        result->error = analyze_error(strdup("Invalid input: query cannot be null or empty"));
+        return result;
+    }
+
+    MemoryContext ctx_mem = pg_query_enter_memory_context();
+    PgQueryInternalParsetreeAndError parsed = TIMED(pg_query_raw_parse(input, PG_QUERY_PARSE_DEFAULT));
+    free(parsed.stderr_buffer);
+
+    if (parsed.error) {
+        // Allocated with malloc, so it outlives the memory context
+        result->error = parsed.error;
+    }
+
+    if ((flags & ANALYZE_PARSE) && !result->error) {
+        char* tree_json = TIMED(pg_query_nodes_to_json(parsed.tree));
+        result->parse_tree = strdup(tree_json);
+        pfree(tree_json);
+        if (!result->parse_tree) {
+            result->error = analyze_error(NULL);
+        }
+    }
+
+    // The walkers open and delete their own memory context from the top one,
+    // as they do when called on text; the tree stays in ctx_mem meanwhile
+    if ((flags & ANALYZE_FINGERPRINT) && !result->error) {
+        MemoryContextSwitchTo(TopMemoryContext);
+        PgQueryFingerprintResult fingerprint = TIMED(analyze_fingerprint(parsed.tree));
+        MemoryContextSwitchTo(ctx_mem);
+        result->fingerprint_str = fingerprint.fingerprint_str;
+        result->error = fingerprint.error;
+        fingerprint.fingerprint_str = NULL;
+        fingerprint.error = NULL;
+        pg_query_free_fingerprint_result(fingerprint);
+    }
+
+    if ((flags & ANALYZE_NORMALIZE) && !result->error) {
+        MemoryContextSwitchTo(TopMemoryContext);
+        PgQueryNormalizeResult normalized = TIMED(analyze_normalize(input, parsed.tree));
+        MemoryContextSwitchTo(ctx_mem);
+        result->normalized_query = normalized.normalized_query;
+        result->error = normalized.error;
+    }
+
+    // Frees the tree
+    pg_query_exit_memory_context(ctx_mem);
+
+    if ((flags & ANALYZE_SCAN) && !result->error) {
+        char* message = NULL;
+        result->scan = wasm_scan_binary(input, &message);
+        if (!result->scan) {
+            result->error = analyze_error(message);
+        }
+    }
+
+    return result;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_free_analyze_result(WasmAnalyzeResult* result) {
+    if (result) {
+        free(result->parse_tree);
+        free(result->normalized_query);
+        free(result->fingerprint_str);
+        free(result->scan);
+        if (result->error) {
+            free(result->error->message);
+            free(result->error->funcname);
+            free(result->error->filename);
+            free(result->error->context);
+            free(result->error);
+        }
+        free(result);
+    }
+}
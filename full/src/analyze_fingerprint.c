@@ -0,0 +1,46 @@
+// libpg_query's fingerprint walker, compiled here so wasm_analyze can run it on
+// a tree it has already parsed. pg_query_fingerprint_with_opts is used as is:
+// its call to pg_query_raw_parse is redirected to that tree, and its public
+// functions are renamed so they do not clash with the copies in libpg_query.a.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // asprintf
+#endif
+
+#include "pg_query.h"
+#include "pg_query_internal.h"
+#include "wasm_wrapper.h"
+
+// Set for the duration of one analyze_fingerprint call; per thread, as pool
+// workers share one copy of the native addon per process
+static _Thread_local List* analyzed_tree;
+
+#define pg_query_raw_parse(input, parser_options) \
+    ((PgQueryInternalParsetreeAndError){ .tree = analyzed_tree })
+#define pg_query_fingerprint analyze_fingerprint_text
+#define pg_query_fingerprint_opts analyze_fingerprint_opts
+#define pg_query_fingerprint_with_opts analyze_fingerprint_with_opts
+#define pg_query_fingerprint_node analyze_fingerprint_node
+#define pg_query_free_fingerprint_result analyze_free_fingerprint_result
+
+// Built with the same warnings off as libpg_query builds it
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#pragma GCC diagnostic ignored "-Wunused-value"
+#include "pg_query_fingerprint.c"
+#pragma GCC diagnostic pop
+
+#undef pg_query_raw_parse
+#undef pg_query_fingerprint
+#undef pg_query_fingerprint_opts
+#undef pg_query_fingerprint_with_opts
+#undef pg_query_fingerprint_node
+#undef pg_query_free_fingerprint_result
+
+PgQueryFingerprintResult analyze_fingerprint(void* tree) {
+    analyzed_tree = (List*)tree;
+    PgQueryFingerprintResult result = analyze_fingerprint_with_opts("", PG_QUERY_PARSE_DEFAULT, false);
+    analyzed_tree = NULL;
+    return result;
+}
@@ -0,0 +1,43 @@
+// libpg_query's normalize walker, compiled here so wasm_analyze can run it on a
+// tree it has already parsed. pg_query_normalize is used as is: its call to
+// raw_parser is redirected to that tree, and its public functions are renamed
+// so they do not clash with the copies in libpg_query.a. Constant lengths are
+// still found by rescanning the text, as in pg_query_normalize.
+
+#include "pg_query.h"
+#include "pg_query_internal.h"
+#include "wasm_wrapper.h"
+
+#include "parser/parser.h"
+
+// Set for the duration of one analyze_normalize call; per thread, as pool
+// workers share one copy of the native addon per process
+static _Thread_local List* analyzed_tree;
+
+#define raw_parser(str, mode) (analyzed_tree)
+#define pg_query_raw_parse(input, parser_options) \
+    ((PgQueryInternalParsetreeAndError){ .tree = analyzed_tree })
+#define pg_query_normalize analyze_normalize_text
+#define pg_query_normalize_utility analyze_normalize_utility
+#define pg_query_free_normalize_result analyze_free_normalize_result
+
+// Built with the same warnings off as libpg_query builds it
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#pragma GCC diagnostic ignored "-Wunused-value"
+#include "pg_query_normalize.c"
+#pragma GCC diagnostic pop
+
+#undef raw_parser
+#undef pg_query_raw_parse
+#undef pg_query_normalize
+#undef pg_query_normalize_utility
+#undef pg_query_free_normalize_result
+
+PgQueryNormalizeResult analyze_normalize(const char* input, void* tree) {
+    analyzed_tree = (List*)tree;
+    PgQueryNormalizeResult result = analyze_normalize_text(input);
+    analyzed_tree = NULL;
+    return result;
+}
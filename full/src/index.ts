@@ -1,4 +1,5 @@
 import { ParseResult } from "@pgsql/types";
+import type { MessagePort, Worker } from "worker_threads";
 export * from "@pgsql/types";
 
 export interface ScanToken {
@@ -16,6 +17,48 @@ export interface ScanResult {
   tokens: ScanToken[];
 }
 
+export interface ParseBatchItem {
+  result?: ParseResult;
+  error?: Error;
+}
+
+export interface ValidationResult {
+  valid: boolean;
+  error?: SqlErrorDetails;  // Message and 0-based cursorPosition when invalid
+}
+
+export interface SqlStatement {
+  /** UTF-8 byte offset of the statement in the whole stream */
+  location: number;
+  /** Length of the statement in UTF-8 bytes, excluding the terminating semicolon */
+  length: number;
+  sql: string;
+}
+
+export interface ParsedStatement extends SqlStatement {
+  parseTree: ParseResult;
+}
+
+export interface PlPgSQLFunction extends SqlStatement {
+  /** { plpgsql_funcs: [...] }, as from parsePlPgSQL */
+  parseTree?: ParseResult;
+  /** Set instead of parseTree when the function fails to parse; cursorPosition is within sql */
+  error?: SqlErrorDetails;
+}
+
+export interface QueryCacheOptions {
+  maxBytes: number;
+}
+
+export interface QueryCacheStats {
+  hits: number;
+  misses: number;
+  evictions: number;
+  entries: number;
+  bytes: number;
+  maxBytes: number;
+}
+
 export interface SqlErrorDetails {
   message: string;
   cursorPosition: number;
@@ -116,7 +159,7 @@ export function formatSqlError(
 // @ts-ignore
 import PgQueryModule from './libpg-query.js';
 // @ts-ignore
-import { pg_query } from '../proto.js';
+import { messages as protoMessages, enums as protoEnums } from '../proto-schema.js';
 
 interface WasmModule {
   _malloc: (size: number) => number;
@@ -125,6 +168,26 @@ interface WasmModule {
   _wasm_parse_query: (queryPtr: number) => number;
   _wasm_parse_query_raw: (queryPtr: number) => number;
   _wasm_free_parse_result: (ptr: number) => void;
+  _wasm_parse_batch: (queriesPtr: number, count: number) => number;
+  _wasm_free_parse_batch: (ptr: number, count: number) => void;
+  _wasm_parse_query_protobuf_raw: (queryPtr: number) => number;
+  _wasm_free_protobuf_parse_result: (ptr: number) => void;
+  _wasm_fingerprint_batch: (queriesPtr: number, count: number, outPtr: number) => number;
+  _wasm_validate_batch: (queriesPtr: number, count: number, outPtr: number) => number;
+  _wasm_normalize_batch: (queriesPtr: number, count: number, outPtr: number) => number;
+  _wasm_free_normalize_batch: (outPtr: number, count: number) => void;
+  _wasm_scan_binary: (queryPtr: number, errorPtrPtr: number) => number;
+  _wasm_scan_fast: (queryPtr: number, errorPtrPtr: number) => number;
+  _wasm_analyze: (queryPtr: number, flags: number) => number;
+  _wasm_free_analyze_result: (ptr: number) => void;
+  _wasm_extract_references: (queryPtr: number) => number;
+  _wasm_free_references_result: (ptr: number) => void;
+  _wasm_split_statements: (inputPtr: number, errorPtrPtr: number) => number;
+  _wasm_parse_plpgsql_dump: (inputPtr: number, errorPtrPtr: number) => number;
+  _wasm_free_plpgsql_dump: (ptr: number) => void;
+  _wasm_heap_used: () => number;
+  _wasm_set_timing: (enabled: number) => void;
+  _wasm_take_timing: () => number;
   _wasm_deparse_protobuf: (dataPtr: number, length: number) => number;
   _wasm_parse_plpgsql: (queryPtr: number) => number;
   _wasm_fingerprint: (queryPtr: number) => number;
@@ -137,45 +200,326 @@ interface WasmModule {
   HEAPU8: Uint8Array;
 }
 
+export interface HeapStats {
+  /** Bytes currently allocated with malloc inside the WASM heap */
+  usedBytes: number;
+  /** Size of the module's linear memory, which only ever grows */
+  memoryBytes: number;
+  /** Largest linear memory size reached since load, across recycles */
+  peakMemoryBytes: number;
+  /** Number of times the module has been recycled */
+  recycles: number;
+}
+
+export type Backend = 'native' | 'wasm';
+
+export interface LoadModuleOptions {
+  /** A compiled libpg-query.wasm, e.g. from getCompiledModule() on another thread */
+  wasmModule?: WebAssembly.Module;
+  /**
+   * 'auto' (the default) uses the native addon when one was built for this
+   * platform and WASM otherwise; 'native' fails when the addon is missing.
+   * Also read from the LIBPG_QUERY_BACKEND environment variable.
+   */
+  backend?: Backend | 'auto';
+}
+
+export interface RecyclePolicy {
+  /** Recycle once linear memory grows past this many bytes */
+  maxMemoryBytes: number;
+}
+
 let wasmModule: WasmModule;
 
-const initPromise = PgQueryModule().then((module: WasmModule) => {
-  wasmModule = module;
-});
+// Node-API build of the same wrapper (see the Makefile). Each method takes and
+// returns what the WASM path writes to and reads from the heap, with
+// PgQueryError fields on the Errors it throws. The WASM module is loaded
+// either way, for the heap and compiled-module APIs and as the fallback.
+interface NativeAddon {
+  parse(query: string): string;
+  parseProtobuf(query: string): Uint8Array;
+  deparse(data: Uint8Array): string;
+  parsePlPgSQL(query: string): string;
+  fingerprint(query: string): string;
+  normalize(query: string): string;
+  scan(query: string): string;
+  scanBinary(query: string, fast: boolean): Int32Array;
+  splitStatements(input: Uint8Array): Int32Array;
+  parseBatch(packed: string, count: number): (string | Error | null)[];
+  validateBatch(packed: string, count: number): ([string, number] | null)[];
+  fingerprintBatch(packed: string, count: number): BigUint64Array;
+  normalizeBatch(packed: string, count: number): ([string, Int32Array] | string)[];
+  analyze(query: string, flags: number): { parseTree?: string; normalized?: string; fingerprint?: string; scan?: Int32Array };
+  extractReferences(query: string): ArrayBuffer;
+  parsePlPgSQLDump(input: Uint8Array): [number, number, string | null, string | null, number][];
+  setTiming(enabled: boolean): void;
+  takeTiming(): number;
+}
+
+let nativeAddon: NativeAddon | null = null;
+
+// Relative to this file; rewritten for the build profiles in wasm/<profile>/
+const NATIVE_ADDON_DIR = '../native';
+
+function loadNativeAddon(backend: Backend | 'auto'): void {
+  if (backend === 'wasm') {
+    return;
+  }
+  if (typeof process === 'undefined' || !process.versions?.node) {
+    if (backend === 'native') {
+      throw new Error('The native backend is only available in Node.js');
+    }
+    return;
+  }
+  const addonPath = `${NATIVE_ADDON_DIR}/${process.platform}-${process.arch}/libpg-query.node`;
+  try {
+    nativeAddon = nodeRequire(addonPath);
+  } catch (error: any) {
+    if (backend === 'native') {
+      throw new Error(`Failed to load the native addon ${addonPath}: ${error.message}`);
+    }
+  }
+}
+
+function defaultBackend(): Backend | 'auto' {
+  const backend = typeof process !== 'undefined' ? process.env?.LIBPG_QUERY_BACKEND : undefined;
+  if (backend === undefined || backend === '') {
+    return 'auto';
+  }
+  if (backend !== 'auto' && backend !== 'native' && backend !== 'wasm') {
+    throw new Error(`Invalid LIBPG_QUERY_BACKEND: ${backend}. Use auto, native or wasm`);
+  }
+  return backend;
+}
+
+/** The backend calls run on once loaded: the native addon or WASM */
+export function getBackend(): Backend {
+  return nativeAddon ? 'native' : 'wasm';
+}
+
+// The compiled libpg-query.wasm, kept so that recycle() can instantiate a fresh
+// module without compiling it again
+let compiledWasm: WebAssembly.Module | null = null;
+let compilePromise: Promise<WebAssembly.Module | null> | null = null;
+
+// URL of this file in the ES module build, where scripts/build.js sets it to
+// import.meta.url; the CommonJS build has __dirname instead
+const ESM_MODULE_URL: string | undefined = undefined;
+
+// Compiles libpg-query.wasm, which sits next to this file, so the compiled
+// module can be kept without Emscripten having to expose it. Returns null
+// where the binary cannot be located; Emscripten then loads it itself.
+async function compileWasm(): Promise<WebAssembly.Module | null> {
+  const isNode = typeof process !== 'undefined' && !!process.versions?.node;
+  if (isNode && typeof __dirname !== 'undefined' && typeof require === 'function') {
+    const { readFile } = nodeRequire('fs/promises');
+    return WebAssembly.compile(await readFile(nodeRequire('path').join(__dirname, 'libpg-query.wasm')));
+  }
+  if (!ESM_MODULE_URL) {
+    return null;
+  }
+  const url = new URL('libpg-query.wasm', ESM_MODULE_URL);
+  if (isNode && url.protocol === 'file:') {
+    const { readFile } = nodeRequire('fs/promises');
+    return WebAssembly.compile(await readFile(url));
+  }
+  const response = await fetch(url);
+  if (!response.ok) {
+    throw new Error(`Failed to fetch ${url}: ${response.status}`);
+  }
+  return WebAssembly.compile(await response.arrayBuffer());
+}
+
+function getCompiledWasm(): Promise<WebAssembly.Module | null> {
+  if (compiledWasm) {
+    return Promise.resolve(compiledWasm);
+  }
+  compilePromise ??= compileWasm().then(
+    (module) => (compiledWasm ??= module),
+    (error) => {
+      compilePromise = null;
+      throw error;
+    }
+  );
+  return compilePromise;
+}
+
+async function instantiateModule(): Promise<WasmModule> {
+  const compiled = await getCompiledWasm();
+  if (!compiled) {
+    return PgQueryModule();
+  }
+  return new Promise((resolve, reject) => {
+    PgQueryModule({
+      instantiateWasm(
+        imports: WebAssembly.Imports,
+        receiveInstance: (instance: WebAssembly.Instance, module: WebAssembly.Module) => void
+      ) {
+        WebAssembly.instantiate(compiled, imports).then(
+          (instance) => receiveInstance(instance, compiled),
+          reject
+        );
+        return {};
+      }
+    }).then(resolve, reject);
+  });
+}
+
+let initPromise: Promise<void> | null = null;
+
+// The module is instantiated on first use rather than on import, so that a
+// compiled module passed to loadModule() is used before anything is compiled
+function init(options: LoadModuleOptions = {}): Promise<void> {
+  if (!initPromise) {
+    if (options.wasmModule) {
+      compiledWasm = options.wasmModule;
+    }
+    const backend = options.backend ?? defaultBackend();
+    initPromise = loadEsmRequire().then(instantiateModule).then((module: WasmModule) => {
+      loadNativeAddon(backend);
+      wasmModule = module;
+    });
+    // Let a failed load be retried
+    initPromise.catch(() => {
+      initPromise = null;
+    });
+  }
+  return initPromise;
+}
 
 function ensureLoaded() {
   if (!wasmModule) throw new Error("WASM module not initialized. Call `loadModule()` first.");
 }
 
-export async function loadModule(): Promise<void> {
+export async function loadModule(options?: LoadModuleOptions): Promise<void> {
   if (!wasmModule) {
-    await initPromise;
+    await init(options);
   }
 }
 
+/**
+ * Returns the compiled libpg-query.wasm. Pass it to `loadModule({ wasmModule })`
+ * in a worker to skip compiling the binary there; WebAssembly.Module can be
+ * sent with postMessage or workerData. Null where the binary could not be
+ * located next to this module, and Emscripten loaded it itself.
+ */
+export async function getCompiledModule(): Promise<WebAssembly.Module> {
+  await init();
+  return compiledWasm;
+}
+
 function awaitInit<T extends (...args: any[]) => Promise<any>>(fn: T): T {
   return (async (...args: Parameters<T>) => {
-    await initPromise;
+    await init();
     return fn(...args);
   }) as T;
 }
 
+// Query text up to this size is written into one reusable scratch buffer rather
+// than a fresh malloc per call. Every call holds its input only for the duration
+// of a synchronous WASM call, so a single buffer is enough; anything larger, or a
+// second input while the buffer is taken, goes through malloc as before.
+const INPUT_SCRATCH_MAX_BYTES = 64 * 1024;
+
+let inputScratchPtr = 0;
+let inputScratchSize = 0;
+let inputScratchInUse = false;
+
 function stringToPtr(str: string): number {
   ensureLoaded();
   if (typeof str !== 'string') {
     throw new TypeError(`Expected a string, got ${typeof str}`);
   }
   const len = wasmModule.lengthBytesUTF8(str) + 1;
-  const ptr = wasmModule._malloc(len);
+  let ptr: number;
+  if (!inputScratchInUse && len <= INPUT_SCRATCH_MAX_BYTES) {
+    if (len > inputScratchSize) {
+      if (inputScratchPtr) {
+        wasmModule._free(inputScratchPtr);
+      }
+      inputScratchSize = Math.min(INPUT_SCRATCH_MAX_BYTES, Math.max(1024, 2 ** Math.ceil(Math.log2(len))));
+      inputScratchPtr = wasmModule._malloc(inputScratchSize);
+    }
+    inputScratchInUse = true;
+    ptr = inputScratchPtr;
+  } else {
+    ptr = wasmModule._malloc(len);
+  }
   try {
     wasmModule.stringToUTF8(str, ptr, len);
     return ptr;
   } catch (error) {
-    wasmModule._free(ptr);
+    freeInput(ptr);
     throw error;
   }
 }
 
+// Releases a pointer returned by stringToPtr. Every call that takes an input ends
+// here, so this is also where the recycle policy is checked.
+function freeInput(ptr: number): void {
+  if (inputScratchInUse && ptr === inputScratchPtr) {
+    inputScratchInUse = false;
+  } else {
+    wasmModule._free(ptr);
+  }
+  if (recyclePolicy && !recyclePromise && wasmModule.HEAPU8.length > recyclePolicy.maxMemoryBytes) {
+    // Failures leave the current module in place; the next call tries again
+    recycle().catch(() => {});
+  }
+}
+
+let recyclePolicy: RecyclePolicy | null = null;
+let recyclePromise: Promise<void> | null = null;
+let recycles = 0;
+let peakMemoryBytes = 0;
+
+export function getHeapStats(): HeapStats {
+  ensureLoaded();
+  const memoryBytes = wasmModule.HEAPU8.length;
+  peakMemoryBytes = Math.max(peakMemoryBytes, memoryBytes);
+  return {
+    usedBytes: wasmModule._wasm_heap_used() >>> 0,
+    memoryBytes,
+    peakMemoryBytes,
+    recycles
+  };
+}
+
+/**
+ * Recycles the module automatically once its linear memory grows past
+ * `maxMemoryBytes`. Pass `null` to turn the policy off.
+ */
+export function setRecyclePolicy(policy: RecyclePolicy | null): void {
+  if (policy && !(policy.maxMemoryBytes > 0)) {
+    throw new Error('Recycle policy maxMemoryBytes must be a positive number');
+  }
+  recyclePolicy = policy;
+}
+
+/**
+ * Replaces the module with a fresh instance of the same compiled WebAssembly
+ * module, releasing the linear memory the old one had grown to. Calls made
+ * while the new instance is starting keep running on the old one; every WASM
+ * call is synchronous, so the switch never happens in the middle of one.
+ */
+export function recycle(): Promise<void> {
+  recyclePromise ??= (async () => {
+    await init();
+    try {
+      const module = await instantiateModule();
+      peakMemoryBytes = Math.max(peakMemoryBytes, wasmModule.HEAPU8.length);
+      wasmModule = module;
+      inputScratchPtr = 0;
+      inputScratchSize = 0;
+      inputScratchInUse = false;
+      recycles++;
+    } finally {
+      recyclePromise = null;
+    }
+  })();
+  return recyclePromise;
+}
+
 function ptrToString(ptr: number): string {
   ensureLoaded();
   if (typeof ptr !== 'number') {
@@ -184,7 +528,439 @@ function ptrToString(ptr: number): string {
   return wasmModule.UTF8ToString(ptr);
 }
 
-export const parse = awaitInit(async (query: string): Promise<ParseResult> => {
+// Copies a NUL-terminated C string out of the heap as raw UTF-8 bytes
+function ptrToBytes(ptr: number): Uint8Array {
+  ensureLoaded();
+  const end = wasmModule.HEAPU8.indexOf(0, ptr);
+  return wasmModule.HEAPU8.slice(ptr, end);
+}
+
+// sizeof(PgQueryParseResult): { char* parse_tree; char* stderr_buffer; PgQueryError* error; }
+const PARSE_RESULT_SIZE = 12;
+
+function readSqlError(errorPtr: number): SqlError {
+  // Read PgQueryError struct
+  const messagePtr = wasmModule.getValue(errorPtr, 'i32');
+  const funcnamePtr = wasmModule.getValue(errorPtr + 4, 'i32');
+  const filenamePtr = wasmModule.getValue(errorPtr + 8, 'i32');
+  const lineno = wasmModule.getValue(errorPtr + 12, 'i32');
+  const cursorpos = wasmModule.getValue(errorPtr + 16, 'i32');
+
+  const message = messagePtr ? wasmModule.UTF8ToString(messagePtr) : 'Unknown error';
+  const funcname = funcnamePtr ? wasmModule.UTF8ToString(funcnamePtr) : undefined;
+  const filename = filenamePtr ? wasmModule.UTF8ToString(filenamePtr) : undefined;
+
+  return new SqlError(message, {
+    message,
+    cursorPosition: cursorpos > 0 ? cursorpos - 1 : 0, // Convert to 0-based
+    fileName: filename,
+    functionName: funcname,
+    lineNumber: lineno > 0 ? lineno : undefined
+  });
+}
+
+// Opt-in LRU cache for parse, fingerprint, normalize and scan, keyed by query
+// text. Entry sizes are estimated from the UTF-16 length of the key and of the
+// serialized result; cached values are deep-frozen so callers cannot corrupt them.
+class QueryCache {
+  private entries = new Map<string, { value: any; bytes: number }>();
+  private bytes = 0;
+  private hits = 0;
+  private misses = 0;
+  private evictions = 0;
+
+  constructor(private maxBytes: number) {}
+
+  get(key: string): any {
+    const entry = this.entries.get(key);
+    if (!entry) {
+      this.misses++;
+      return undefined;
+    }
+    // Map iteration order is insertion order: re-inserting marks it most recent
+    this.entries.delete(key);
+    this.entries.set(key, entry);
+    this.hits++;
+    return entry.value;
+  }
+
+  set(key: string, value: any, bytes: number) {
+    if (bytes > this.maxBytes) {
+      return;
+    }
+    this.entries.set(key, { value: deepFreeze(value), bytes });
+    this.bytes += bytes;
+    while (this.bytes > this.maxBytes) {
+      const [oldestKey, oldest] = this.entries.entries().next().value!;
+      this.entries.delete(oldestKey);
+      this.bytes -= oldest.bytes;
+      this.evictions++;
+    }
+  }
+
+  clear() {
+    this.entries.clear();
+    this.bytes = 0;
+  }
+
+  stats(): QueryCacheStats {
+    return {
+      hits: this.hits,
+      misses: this.misses,
+      evictions: this.evictions,
+      entries: this.entries.size,
+      bytes: this.bytes,
+      maxBytes: this.maxBytes
+    };
+  }
+}
+
+let queryCache: QueryCache | null = null;
+
+export function enableCache(options: QueryCacheOptions): void {
+  if (!options || !(options.maxBytes > 0)) {
+    throw new Error('Cache maxBytes must be a positive number');
+  }
+  queryCache = new QueryCache(options.maxBytes);
+}
+
+export function disableCache(): void {
+  queryCache = null;
+}
+
+export function clearCache(): void {
+  queryCache?.clear();
+}
+
+export function getCacheStats(): QueryCacheStats | null {
+  return queryCache ? queryCache.stats() : null;
+}
+
+function deepFreeze<T>(value: T): T {
+  if (value && typeof value === 'object' && !Object.isFrozen(value)) {
+    Object.freeze(value);
+    for (const child of Object.values(value)) {
+      deepFreeze(child);
+    }
+  }
+  return value;
+}
+
+// `compute` returns the result and the length of its serialized form
+function cached<T>(kind: string, query: string, compute: () => [T, number]): T {
+  const cache = queryCache;
+  if (!cache || typeof query !== 'string') {
+    return compute()[0];
+  }
+
+  const key = kind + query;
+  const hit = cache.get(key);
+  if (hit !== undefined) {
+    return hit;
+  }
+
+  const [value, length] = compute();
+  cache.set(key, value, (key.length + length) * 2);
+  return value;
+}
+
+export interface StatsHistogram {
+  count: number;
+  sum: number;        // Milliseconds
+  buckets: number[];  // Cumulative counts at each bound in ParserStats.bucketsMs, as Prometheus expects
+}
+
+export interface OperationStats {
+  calls: number;
+  errors: number;
+  background: number;          // Calls run on an async worker; these only add to totalMs
+  bytesIn: number;             // Input bytes written into the WASM heap
+  bytesOut: number;            // Result bytes read back out of it
+  heapGrowths: number;         // Calls during which linear memory grew
+  totalMs: StatsHistogram;
+  marshalMs: StatsHistogram;   // Copying or encoding the input into the WASM heap
+  wasmMs: StatsHistogram;      // Inside libpg_query, timed in wasm_wrapper.c
+  decodeMs: StatsHistogram;    // Reading the result back, including JSON.parse
+}
+
+export interface ParserStats {
+  bucketsMs: number[];
+  operations: Record<string, OperationStats>;
+  memoryBytes: number;
+}
+
+export interface CallSample {
+  operation: string;
+  background: boolean;
+  error: boolean;
+  totalMs: number;
+  marshalMs: number;
+  wasmMs: number;
+  decodeMs: number;
+  bytesIn: number;
+  bytesOut: number;
+  heapGrowthBytes: number;
+}
+
+export interface StatsOptions {
+  onCall?: (sample: CallSample) => void;  // Called after every instrumented call
+}
+
+// Histogram bounds in milliseconds, shared by every histogram
+const STATS_BUCKETS_MS = [0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, Infinity];
+
+function emptyHistogram(): StatsHistogram {
+  return { count: 0, sum: 0, buckets: STATS_BUCKETS_MS.map(() => 0) };
+}
+
+function observe(histogram: StatsHistogram, ms: number) {
+  histogram.count++;
+  histogram.sum += ms;
+  for (let i = STATS_BUCKETS_MS.length - 1; i >= 0 && ms <= STATS_BUCKETS_MS[i]; i--) {
+    histogram.buckets[i]++;
+  }
+}
+
+// Opt-in per-operation counters and timings. Cache hits never reach WASM and
+// are not counted here; getCacheStats() reports those.
+class StatsCollector {
+  operations: Record<string, OperationStats> = {};
+
+  constructor(private onCall?: (sample: CallSample) => void) {}
+
+  record(sample: CallSample) {
+    const op = this.operations[sample.operation] ??= {
+      calls: 0,
+      errors: 0,
+      background: 0,
+      bytesIn: 0,
+      bytesOut: 0,
+      heapGrowths: 0,
+      totalMs: emptyHistogram(),
+      marshalMs: emptyHistogram(),
+      wasmMs: emptyHistogram(),
+      decodeMs: emptyHistogram()
+    };
+    op.calls++;
+    op.errors += sample.error ? 1 : 0;
+    op.bytesIn += sample.bytesIn;
+    op.bytesOut += sample.bytesOut;
+    op.heapGrowths += sample.heapGrowthBytes > 0 ? 1 : 0;
+    observe(op.totalMs, sample.totalMs);
+    if (sample.background) {
+      op.background++;
+    } else {
+      observe(op.marshalMs, sample.marshalMs);
+      observe(op.wasmMs, sample.wasmMs);
+      observe(op.decodeMs, sample.decodeMs);
+    }
+    if (this.onCall) {
+      try {
+        this.onCall(sample);
+      } catch {
+        // A failing metrics callback must not fail the call it reports on
+      }
+    }
+  }
+}
+
+// Timings for one call into WASM, taken only while stats are enabled. Callers
+// mark the input as written, the WASM call as returned and the result as read;
+// a call that throws before its result is read is counted as an error.
+class CallProbe {
+  private readonly started = performance.now();
+  private readonly memoryBytes = wasmModule.HEAPU8.length;
+  private marshalled = 0;
+  private called = 0;
+  private decoded = 0;
+  private wasmMs = 0;
+  private bytesIn = 0;
+  private bytesOut = 0;
+
+  constructor(private collector: StatsCollector, private operation: string) {
+    // Also resets the C-side total, and turns timing on in a freshly recycled module
+    if (nativeAddon) {
+      nativeAddon.setTiming(true);
+    } else {
+      wasmModule._wasm_set_timing(1);
+    }
+  }
+
+  input(bytes: number) {
+    this.marshalled = performance.now();
+    this.bytesIn = bytes;
+  }
+
+  returned() {
+    this.called = performance.now();
+    this.wasmMs = nativeAddon ? nativeAddon.takeTiming() : wasmModule._wasm_take_timing();
+  }
+
+  output(bytes: number) {
+    this.decoded = performance.now();
+    this.bytesOut = bytes;
+  }
+
+  finish() {
+    const finished = performance.now();
+    const marshalled = this.marshalled || finished;
+    const called = this.called || marshalled;
+    this.collector.record({
+      operation: this.operation,
+      background: false,
+      error: !this.decoded,
+      totalMs: finished - this.started,
+      marshalMs: marshalled - this.started,
+      wasmMs: this.wasmMs,
+      decodeMs: (this.decoded || finished) - called,
+      bytesIn: this.bytesIn,
+      bytesOut: this.bytesOut,
+      heapGrowthBytes: wasmModule.HEAPU8.length - this.memoryBytes
+    });
+  }
+}
+
+let stats: StatsCollector | null = null;
+
+export function enableStats(options: StatsOptions = {}): void {
+  stats = new StatsCollector(options.onCall);
+}
+
+export function disableStats(): void {
+  stats = null;
+  wasmModule?._wasm_set_timing(0);
+  nativeAddon?.setTiming(false);
+}
+
+export function resetStats(): void {
+  if (stats) {
+    stats.operations = {};
+  }
+}
+
+export function getStats(): ParserStats | null {
+  if (!stats) {
+    return null;
+  }
+  const operations: Record<string, OperationStats> = {};
+  for (const [name, op] of Object.entries(stats.operations)) {
+    operations[name] = {
+      ...op,
+      totalMs: { ...op.totalMs, buckets: op.totalMs.buckets.slice() },
+      marshalMs: { ...op.marshalMs, buckets: op.marshalMs.buckets.slice() },
+      wasmMs: { ...op.wasmMs, buckets: op.wasmMs.buckets.slice() },
+      decodeMs: { ...op.decodeMs, buckets: op.decodeMs.buckets.slice() }
+    };
+  }
+  return {
+    bucketsMs: STATS_BUCKETS_MS.slice(),
+    operations,
+    memoryBytes: wasmModule ? wasmModule.HEAPU8.length : 0
+  };
+}
+
+// Runs one native addon call with the same stats as a WASM call: `decode`
+// turns the addon's result into the value returned and its size in bytes.
+// Errors carrying PgQueryError fields become SqlErrors, as from readSqlError.
+function callNative<R, T>(
+  operation: string,
+  input: string | Uint8Array,
+  call: (addon: NativeAddon) => R,
+  decode: (raw: R) => [T, number]
+): T {
+  const probe = stats && new CallProbe(stats, operation);
+  probe?.input(typeof input === 'string' ? wasmModule.lengthBytesUTF8(input) : input.length);
+  try {
+    let raw: R;
+    try {
+      raw = call(nativeAddon!);
+    } catch (error) {
+      throw nativeError(error);
+    }
+    probe?.returned();
+    const [value, bytes] = decode(raw);
+    probe?.output(bytes);
+    return value;
+  } finally {
+    probe?.finish();
+  }
+}
+
+function nativeError(error: any): Error {
+  if (!(error instanceof Error) || typeof (error as any).cursorpos !== 'number') {
+    return error;
+  }
+  const { cursorpos, lineno, funcname, filename } = error as any;
+  return new SqlError(error.message, {
+    message: error.message,
+    cursorPosition: cursorpos > 0 ? cursorpos - 1 : 0, // Convert to 0-based
+    fileName: filename,
+    functionName: funcname,
+    lineNumber: lineno > 0 ? lineno : undefined
+  });
+}
+
+// Results of the calls that report errors as the message text in place of
+// the result string
+function checkResultString(resultStr: string): string {
+  if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
+    throw new Error(resultStr);
+  }
+  return resultStr;
+}
+
+export const parse = awaitInit(async (query: string, options?: CallOptions): Promise<ParseResult> => {
+  return runInBackground('parse', query, options, () => parseSync(query));
+});
+
+export const deparse = awaitInit(async (parseTree: ParseResult, options?: CallOptions): Promise<string> => {
+  return runInBackground('deparse', parseTree, options, () => deparseSync(parseTree));
+});
+
+export const parsePlPgSQL = awaitInit(async (query: string, options?: CallOptions): Promise<ParseResult> => {
+  return runInBackground('parsePlPgSQL', query, options, () => parsePlPgSQLSync(query));
+});
+
+export const fingerprint = awaitInit(async (query: string, options?: CallOptions): Promise<string> => {
+  return runInBackground('fingerprint', query, options, () => fingerprintSync(query));
+});
+
+export const normalize = awaitInit(async (query: string, options?: CallOptions): Promise<string> => {
+  return runInBackground('normalize', query, options, () => normalizeSync(query));
+});
+
+// Sync versions
+export function parseSync(query: string): ParseResult {
+  return cached('p:', query, () => {
+    if (nativeAddon) {
+      const parseTreeStr = parseNative(query);
+      return [JSON.parse(parseTreeStr), parseTreeStr.length];
+    }
+    return parseWith<[ParseResult, number]>(query, (parseTreePtr) => {
+      const parseTreeStr = wasmModule.UTF8ToString(parseTreePtr);
+      return [JSON.parse(parseTreeStr), parseTreeStr.length];
+    });
+  });
+}
+
+// The parse tree JSON from the native addon, with the checks of parseWith
+function parseNative(query: string): string {
+  if (query === null || query === undefined) {
+    throw new Error('Query cannot be null or undefined');
+  }
+  if (query === '') {
+    throw new Error('Query cannot be empty');
+  }
+  return callNative('parse', query, (addon) => addon.parse(query), (parseTreeStr) => [parseTreeStr, utf8Length(parseTreeStr)]);
+}
+
+// Runs wasm_parse_query_raw and hands the parse tree pointer to `read` while
+// the result struct is still alive, so callers choose how to decode it.
+function parseWith<T>(query: string, read: (parseTreePtr: number) => T): T {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  
   // Input validation
   if (query === null || query === undefined) {
     throw new Error('Query cannot be null or undefined');
@@ -194,356 +970,2727 @@ export const parse = awaitInit(async (query: string): Promise<ParseResult> => {
     throw new Error('Query cannot be empty');
   }
 
+  const probe = stats && new CallProbe(stats, 'parse');
   const queryPtr = stringToPtr(query);
+  probe?.input(wasmModule.lengthBytesUTF8(query));
   let resultPtr = 0;
   
   try {
     resultPtr = wasmModule._wasm_parse_query_raw(queryPtr);
+    probe?.returned();
     if (!resultPtr) {
       throw new Error('Failed to parse query: memory allocation failed');
     }
     
     // Read the PgQueryParseResult struct
     const parseTreePtr = wasmModule.getValue(resultPtr, 'i32');
-    const stderrBufferPtr = wasmModule.getValue(resultPtr + 4, 'i32');
     const errorPtr = wasmModule.getValue(resultPtr + 8, 'i32');
     
     if (errorPtr) {
-      // Read PgQueryError struct
-      const messagePtr = wasmModule.getValue(errorPtr, 'i32');
-      const funcnamePtr = wasmModule.getValue(errorPtr + 4, 'i32');
-      const filenamePtr = wasmModule.getValue(errorPtr + 8, 'i32');
-      const lineno = wasmModule.getValue(errorPtr + 12, 'i32');
-      const cursorpos = wasmModule.getValue(errorPtr + 16, 'i32');
-      
-      const message = messagePtr ? wasmModule.UTF8ToString(messagePtr) : 'Unknown error';
-      const funcname = funcnamePtr ? wasmModule.UTF8ToString(funcnamePtr) : undefined;
-      const filename = filenamePtr ? wasmModule.UTF8ToString(filenamePtr) : undefined;
-      
-      throw new SqlError(message, {
-        message,
-        cursorPosition: cursorpos > 0 ? cursorpos - 1 : 0, // Convert to 0-based
-        fileName: filename,
-        functionName: funcname,
-        lineNumber: lineno > 0 ? lineno : undefined
-      });
+      throw readSqlError(errorPtr);
     }
     
     if (!parseTreePtr) {
       throw new Error('No parse tree generated');
     }
     
-    const parseTreeStr = wasmModule.UTF8ToString(parseTreePtr);
-    return JSON.parse(parseTreeStr);
+    const value = read(parseTreePtr);
+    probe?.output(wasmModule.HEAPU8.indexOf(0, parseTreePtr) - parseTreePtr);
+    return value;
   } finally {
-    wasmModule._free(queryPtr);
+    probe?.finish();
+    freeInput(queryPtr);
     if (resultPtr) {
       wasmModule._wasm_free_parse_result(resultPtr);
     }
   }
-});
+}
+
+export function deparseSync(parseTree: ParseResult): string {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  checkParseTree(parseTree);
+
+  if (nativeAddon) {
+    return deparseProtobuf(encodeParseResult(parseTree));
+  }
+
+  // Encode straight into the WASM heap; nothing below can grow memory before the call
+  const probe = stats && new CallProbe(stats, 'deparse');
+  const writer = new ProtobufWriter();
+  const dataLen = writer.measure(parseTree, 'ParseResult');
+  const dataPtr = wasmModule._malloc(dataLen);
+  
+  try {
+    writer.write(parseTree, 'ParseResult', wasmModule.HEAPU8, dataPtr);
+    return deparseAt(probe, dataPtr, dataLen);
+  } finally {
+    probe?.finish();
+    wasmModule._free(dataPtr);
+  }
+}
 
-export const deparse = awaitInit(async (parseTree: ParseResult): Promise<string> => {
+function checkParseTree(parseTree: ParseResult) {
   if (!parseTree || typeof parseTree !== 'object' || !Array.isArray(parseTree.stmts) || parseTree.stmts.length === 0) {
     throw new Error('No parseTree provided');
   }
+}
 
-  const msg = pg_query.ParseResult.fromObject(parseTree);
-  const data = pg_query.ParseResult.encode(msg).finish();
-  
+// Deparses a ParseResult already encoded as protobuf, as pool workers receive it
+function deparseProtobuf(data: Uint8Array): string {
+  if (nativeAddon) {
+    return callNative('deparse', data, (addon) => addon.deparse(data), (resultStr) => {
+      checkResultString(resultStr);
+      return [resultStr, utf8Length(resultStr)];
+    });
+  }
+
+  const probe = stats && new CallProbe(stats, 'deparse');
   const dataPtr = wasmModule._malloc(data.length);
-  let resultPtr = 0;
-  
   try {
     wasmModule.HEAPU8.set(data, dataPtr);
-    resultPtr = wasmModule._wasm_deparse_protobuf(dataPtr, data.length);
-    const resultStr = ptrToString(resultPtr);
-    
-    if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
-      throw new Error(resultStr);
-    }
-    
-    return resultStr;
+    return deparseAt(probe, dataPtr, data.length);
   } finally {
+    probe?.finish();
     wasmModule._free(dataPtr);
+  }
+}
+
+// Runs wasm_deparse_protobuf on protobuf bytes already in the heap
+function deparseAt(probe: CallProbe | null, dataPtr: number, dataLen: number): string {
+  let resultPtr = 0;
+  try {
+    probe?.input(dataLen);
+    resultPtr = wasmModule._wasm_deparse_protobuf(dataPtr, dataLen);
+    probe?.returned();
+    const resultStr = checkResultString(ptrToString(resultPtr));
+    probe?.output(wasmModule.lengthBytesUTF8(resultStr));
+    return resultStr;
+  } finally {
     if (resultPtr) {
       wasmModule._wasm_free_string(resultPtr);
     }
   }
-});
+}
 
-export const parsePlPgSQL = awaitInit(async (query: string): Promise<ParseResult> => {
-  const queryPtr = stringToPtr(query);
-  let resultPtr = 0;
-  
-  try {
+export function parsePlPgSQLSync(query: string): ParseResult {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  if (nativeAddon) {
+    return callNative('parsePlPgSQL', query, (addon) => addon.parsePlPgSQL(query), (resultStr) => {
+      checkResultString(resultStr);
+      return [JSON.parse(resultStr), utf8Length(resultStr)];
+    });
+  }
+  const probe = stats && new CallProbe(stats, 'parsePlPgSQL');
+  const queryPtr = stringToPtr(query);
+  probe?.input(wasmModule.lengthBytesUTF8(query));
+  let resultPtr = 0;
+  
+  try {
     resultPtr = wasmModule._wasm_parse_plpgsql(queryPtr);
+    probe?.returned();
     const resultStr = ptrToString(resultPtr);
     
     if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
       throw new Error(resultStr);
     }
     
-    return JSON.parse(resultStr);
+    const result = JSON.parse(resultStr);
+    probe?.output(wasmModule.lengthBytesUTF8(resultStr));
+    return result;
   } finally {
-    wasmModule._free(queryPtr);
+    probe?.finish();
+    freeInput(queryPtr);
     if (resultPtr) {
       wasmModule._wasm_free_string(resultPtr);
     }
   }
-});
+}
+
+export function fingerprintSync(query: string): string {
+  return cached('f:', query, () => fingerprintUncached(query));
+}
 
-export const fingerprint = awaitInit(async (query: string): Promise<string> => {
+function fingerprintUncached(query: string): [string, number] {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  if (nativeAddon) {
+    return callNative('fingerprint', query, (addon) => addon.fingerprint(query), (resultStr) => {
+      checkResultString(resultStr);
+      return [[resultStr, resultStr.length], utf8Length(resultStr)];
+    });
+  }
+  const probe = stats && new CallProbe(stats, 'fingerprint');
   const queryPtr = stringToPtr(query);
+  probe?.input(wasmModule.lengthBytesUTF8(query));
   let resultPtr = 0;
   
   try {
     resultPtr = wasmModule._wasm_fingerprint(queryPtr);
+    probe?.returned();
     const resultStr = ptrToString(resultPtr);
     
     if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
       throw new Error(resultStr);
     }
     
-    return resultStr;
+    probe?.output(wasmModule.lengthBytesUTF8(resultStr));
+    return [resultStr, resultStr.length];
   } finally {
-    wasmModule._free(queryPtr);
+    probe?.finish();
+    freeInput(queryPtr);
     if (resultPtr) {
       wasmModule._wasm_free_string(resultPtr);
     }
   }
-});
+}
+
+export function normalizeSync(query: string): string {
+  return cached('n:', query, () => normalizeUncached(query));
+}
 
-export const normalize = awaitInit(async (query: string): Promise<string> => {
+function normalizeUncached(query: string): [string, number] {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  if (nativeAddon) {
+    return callNative('normalize', query, (addon) => addon.normalize(query), (resultStr) => {
+      checkResultString(resultStr);
+      return [[resultStr, resultStr.length], utf8Length(resultStr)];
+    });
+  }
+  const probe = stats && new CallProbe(stats, 'normalize');
   const queryPtr = stringToPtr(query);
+  probe?.input(wasmModule.lengthBytesUTF8(query));
   let resultPtr = 0;
   
   try {
     resultPtr = wasmModule._wasm_normalize_query(queryPtr);
+    probe?.returned();
     const resultStr = ptrToString(resultPtr);
     
     if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
       throw new Error(resultStr);
     }
     
-    return resultStr;
+    probe?.output(wasmModule.lengthBytesUTF8(resultStr));
+    return [resultStr, resultStr.length];
   } finally {
-    wasmModule._free(queryPtr);
+    probe?.finish();
+    freeInput(queryPtr);
     if (resultPtr) {
       wasmModule._wasm_free_string(resultPtr);
     }
   }
+}
+
+export type ConstantKind = 'integer' | 'float' | 'string' | 'bitstring' | 'boolean' | 'null' | 'other';
+
+// Indexed by the CONSTANT_* values in wasm_wrapper.c
+export const CONSTANT_KINDS: readonly ConstantKind[] = ['integer', 'float', 'string', 'bitstring', 'boolean', 'null', 'other'];
+
+// The normalized text and, for each constant replaced by a $n parameter,
+// parallel columns of its parameter number, UTF-8 byte offset and length in
+// the original query, and kind (an index into CONSTANT_KINDS)
+export class NormalizedQuery {
+  readonly count: number;
+  readonly param: Int32Array;
+  readonly location: Int32Array;
+  readonly length: Int32Array;
+  readonly kind: Int32Array;
+
+  constructor(readonly normalizedQuery: string, columns: Int32Array) {
+    const count = columns.length / 4;
+    this.count = count;
+    this.param = columns.subarray(0, count);
+    this.location = columns.subarray(count, 2 * count);
+    this.length = columns.subarray(2 * count, 3 * count);
+    this.kind = columns.subarray(3 * count);
+  }
+
+  kindName(index: number): ConstantKind {
+    return CONSTANT_KINDS[this.kind[index]] ?? 'other';
+  }
+}
+
+export interface NormalizeBatchError {
+  error: string;
+}
+
+// sizeof(WasmNormalizeResult): { char* normalized_query; int32_t* constants; char* error; }
+const NORMALIZE_RESULT_SIZE = 12;
+
+export const normalizeWithConstants = awaitInit(async (query: string): Promise<NormalizedQuery> => {
+  return normalizeWithConstantsSync(query);
 });
 
-// Sync versions
-export function parseSync(query: string): ParseResult {
+export function normalizeWithConstantsSync(query: string): NormalizedQuery {
+  if (typeof query !== 'string') {
+    throw new TypeError(`Expected a string, got ${typeof query}`);
+  }
+  const [result] = normalizeWithConstantsBatchSync([query]);
+  if (!(result instanceof NormalizedQuery)) {
+    throw new Error(result.error);
+  }
+  return result;
+}
+
+export const normalizeWithConstantsBatch = awaitInit(async (queries: string[]): Promise<(NormalizedQuery | NormalizeBatchError)[]> => {
+  return normalizeWithConstantsBatchSync(queries);
+});
+
+// Normalizes many queries in one WASM call, packed like parseBatch. Failures
+// are reported in their slot instead of being thrown.
+export function normalizeWithConstantsBatchSync(queries: string[]): (NormalizedQuery | NormalizeBatchError)[] {
   if (!wasmModule) {
     throw new Error('WASM module not initialized. Call loadModule() first.');
   }
-  
-  // Input validation
-  if (query === null || query === undefined) {
-    throw new Error('Query cannot be null or undefined');
+  if (!Array.isArray(queries)) {
+    throw new TypeError(`Expected an array of strings, got ${typeof queries}`);
   }
-  
-  if (query === '') {
-    throw new Error('Query cannot be empty');
+
+  const count = queries.length;
+  const results: (NormalizedQuery | NormalizeBatchError)[] = new Array(count);
+  if (count === 0) {
+    return results;
   }
 
-  const queryPtr = stringToPtr(query);
-  let resultPtr = 0;
-  
-  try {
-    resultPtr = wasmModule._wasm_parse_query_raw(queryPtr);
-    if (!resultPtr) {
-      throw new Error('Failed to parse query: memory allocation failed');
+  // Same packing as parseBatch: rejected entries go in empty to keep their slot
+  const inputs = queries.map((query, i) => {
+    if (typeof query !== 'string') {
+      throw new TypeError(`Expected a string at index ${i}, got ${typeof query}`);
     }
-    
-    // Read the PgQueryParseResult struct
-    const parseTreePtr = wasmModule.getValue(resultPtr, 'i32');
-    const stderrBufferPtr = wasmModule.getValue(resultPtr + 4, 'i32');
-    const errorPtr = wasmModule.getValue(resultPtr + 8, 'i32');
-    
-    if (errorPtr) {
-      // Read PgQueryError struct
-      const messagePtr = wasmModule.getValue(errorPtr, 'i32');
-      const funcnamePtr = wasmModule.getValue(errorPtr + 4, 'i32');
-      const filenamePtr = wasmModule.getValue(errorPtr + 8, 'i32');
-      const lineno = wasmModule.getValue(errorPtr + 12, 'i32');
-      const cursorpos = wasmModule.getValue(errorPtr + 16, 'i32');
-      
-      const message = messagePtr ? wasmModule.UTF8ToString(messagePtr) : 'Unknown error';
-      const funcname = funcnamePtr ? wasmModule.UTF8ToString(funcnamePtr) : undefined;
-      const filename = filenamePtr ? wasmModule.UTF8ToString(filenamePtr) : undefined;
-      
-      throw new SqlError(message, {
-        message,
-        cursorPosition: cursorpos > 0 ? cursorpos - 1 : 0, // Convert to 0-based
-        fileName: filename,
-        functionName: funcname,
-        lineNumber: lineno > 0 ? lineno : undefined
-      });
+    if (query === '') {
+      results[i] = { error: 'Query cannot be empty' };
+      return '';
     }
-    
-    if (!parseTreePtr) {
-      throw new Error('No parse tree generated');
+    if (query.includes('\0')) {
+      results[i] = { error: 'Query cannot contain NUL characters' };
+      return '';
     }
-    
-    const parseTreeStr = wasmModule.UTF8ToString(parseTreePtr);
-    return JSON.parse(parseTreeStr);
+    return query;
+  });
+
+  const packed = inputs.join('\0');
+  if (nativeAddon) {
+    return callNative('normalizeWithConstants', packed, (addon) => addon.normalizeBatch(packed, count), (normalized) => {
+      let bytes = 0;
+      for (let i = 0; i < count; i++) {
+        if (results[i]) {
+          continue;
+        }
+        const item = normalized[i];
+        if (typeof item === 'string') {
+          results[i] = { error: item };
+          continue;
+        }
+        const [normalizedQuery, columns] = item;
+        bytes += columns.byteLength + 4 + utf8Length(normalizedQuery);
+        results[i] = new NormalizedQuery(normalizedQuery, columns);
+      }
+      return [results, bytes];
+    });
+  }
+
+  const probe = stats && new CallProbe(stats, 'normalizeWithConstants');
+  const queriesPtr = stringToPtr(packed);
+  probe?.input(wasmModule.lengthBytesUTF8(packed));
+  const outPtr = wasmModule._malloc(count * NORMALIZE_RESULT_SIZE);
+  let status = -1;
+
+  try {
+    status = outPtr ? wasmModule._wasm_normalize_batch(queriesPtr, count, outPtr) : -1;
+    probe?.returned();
+    if (status < 0) {
+      throw new Error('Failed to normalize batch: memory allocation failed');
+    }
+
+    let bytes = 0;
+    for (let i = 0; i < count; i++) {
+      const resultPtr = outPtr + i * NORMALIZE_RESULT_SIZE;
+      if (results[i]) {
+        continue;
+      }
+      const normalizedPtr = wasmModule.getValue(resultPtr, 'i32');
+      if (!normalizedPtr) {
+        results[i] = { error: wasmModule.UTF8ToString(wasmModule.getValue(resultPtr + 8, 'i32')) };
+        continue;
+      }
+      // Constants block: [count, param[count], location[count], length[count], kind[count]]
+      const constantsPtr = wasmModule.getValue(resultPtr + 4, 'i32');
+      const constants = wasmModule.getValue(constantsPtr, 'i32');
+      const columns = new Int32Array(wasmModule.HEAPU8.buffer, constantsPtr + 4, 4 * constants).slice();
+      const normalizedQuery = wasmModule.UTF8ToString(normalizedPtr);
+      bytes += columns.byteLength + 4 + wasmModule.lengthBytesUTF8(normalizedQuery);
+      results[i] = new NormalizedQuery(normalizedQuery, columns);
+    }
+
+    probe?.output(bytes);
+    return results;
   } finally {
-    wasmModule._free(queryPtr);
-    if (resultPtr) {
-      wasmModule._wasm_free_parse_result(resultPtr);
+    probe?.finish();
+    freeInput(queriesPtr);
+    if (status >= 0) {
+      // Frees the entries and outPtr itself
+      wasmModule._wasm_free_normalize_batch(outPtr, count);
+    } else if (outPtr) {
+      wasmModule._free(outPtr);
     }
   }
 }
 
-export function deparseSync(parseTree: ParseResult): string {
+export const scan = awaitInit(async (query: string, options?: CallOptions): Promise<ScanResult> => {
+  return runInBackground('scan', query, options, () => scanSync(query));
+});
+
+export function scanSync(query: string): ScanResult {
+  return cached('s:', query, () => scanUncached(query));
+}
+
+function scanUncached(query: string): [ScanResult, number] {
   if (!wasmModule) {
     throw new Error('WASM module not initialized. Call loadModule() first.');
   }
-  if (!parseTree || typeof parseTree !== 'object' || !Array.isArray(parseTree.stmts) || parseTree.stmts.length === 0) {
-    throw new Error('No parseTree provided');
+  if (nativeAddon) {
+    return callNative('scan', query, (addon) => addon.scan(query), (resultStr) => {
+      checkResultString(resultStr);
+      return [[JSON.parse(resultStr), resultStr.length], utf8Length(resultStr)];
+    });
   }
-
-  const msg = pg_query.ParseResult.fromObject(parseTree);
-  const data = pg_query.ParseResult.encode(msg).finish();
-  
-  const dataPtr = wasmModule._malloc(data.length);
+  const probe = stats && new CallProbe(stats, 'scan');
+  const queryPtr = stringToPtr(query);
+  probe?.input(wasmModule.lengthBytesUTF8(query));
   let resultPtr = 0;
   
   try {
-    wasmModule.HEAPU8.set(data, dataPtr);
-    resultPtr = wasmModule._wasm_deparse_protobuf(dataPtr, data.length);
+    resultPtr = wasmModule._wasm_scan(queryPtr);
+    probe?.returned();
     const resultStr = ptrToString(resultPtr);
     
     if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
       throw new Error(resultStr);
     }
     
-    return resultStr;
+    const result = JSON.parse(resultStr);
+    probe?.output(wasmModule.lengthBytesUTF8(resultStr));
+    return [result, resultStr.length];
   } finally {
-    wasmModule._free(dataPtr);
+    probe?.finish();
+    freeInput(queryPtr);
     if (resultPtr) {
       wasmModule._wasm_free_string(resultPtr);
     }
   }
+} 
+
+// Token columns from scanBinary. Offsets are UTF-8 byte offsets, as in scan();
+// text and names are derived on demand instead of being built for every token.
+export class ScanBinaryResult {
+  readonly count: number;
+  readonly start: Int32Array;
+  readonly end: Int32Array;
+  readonly tokenType: Int32Array;
+  readonly keywordKind: Int32Array;
+  private ascii?: boolean;
+  private utf8?: Uint8Array;
+
+  constructor(readonly query: string, readonly version: number, columns: Int32Array) {
+    const count = columns.length / 4;
+    this.count = count;
+    this.start = columns.subarray(0, count);
+    this.end = columns.subarray(count, 2 * count);
+    this.tokenType = columns.subarray(2 * count, 3 * count);
+    this.keywordKind = columns.subarray(3 * count);
+  }
+
+  text(index: number): string {
+    if (this.ascii === undefined) {
+      this.ascii = !/[^\x00-\x7f]/.test(this.query);
+    }
+    // Byte offsets equal string indices for ASCII input
+    if (this.ascii) {
+      return this.query.slice(this.start[index], this.end[index]);
+    }
+    if (!this.utf8) {
+      this.utf8 = utf8Encoder.encode(this.query);
+    }
+    return utf8Decoder.decode(this.utf8.subarray(this.start[index], this.end[index]));
+  }
+
+  tokenName(index: number): string {
+    return protoEnums.Token[this.tokenType[index]] ?? 'UNKNOWN';
+  }
+
+  keywordName(index: number): string {
+    return protoEnums.KeywordKind[this.keywordKind[index]] ?? 'UNKNOWN_KEYWORD';
+  }
 }
 
-export function parsePlPgSQLSync(query: string): ParseResult {
+export const scanBinary = awaitInit(async (query: string): Promise<ScanBinaryResult> => {
+  return scanBinarySync(query);
+});
+
+export function scanBinarySync(query: string): ScanBinaryResult {
+  return scanToColumns(query, 'binary');
+}
+
+// Same tokens as scanBinary. Plain identifiers, keywords, small integers and
+// punctuation are lexed directly (with SIMD in the simd build profile); the
+// rest of the input goes through the PostgreSQL lexer a window at a time.
+export const scanFast = awaitInit(async (query: string): Promise<ScanBinaryResult> => {
+  return scanFastSync(query);
+});
+
+export function scanFastSync(query: string): ScanBinaryResult {
+  return scanToColumns(query, 'fast');
+}
+
+function scanToColumns(query: string, mode: 'binary' | 'fast'): ScanBinaryResult {
   if (!wasmModule) {
     throw new Error('WASM module not initialized. Call loadModule() first.');
   }
+  if (nativeAddon) {
+    return callNative(mode === 'fast' ? 'scanFast' : 'scanBinary', query, (addon) => addon.scanBinary(query, mode === 'fast'),
+      (block) => [scanBlockResult(query, block), block.byteLength]);
+  }
+  const probe = stats && new CallProbe(stats, mode === 'fast' ? 'scanFast' : 'scanBinary');
   const queryPtr = stringToPtr(query);
-  let resultPtr = 0;
+  probe?.input(wasmModule.lengthBytesUTF8(query));
+  const errorPtrPtr = wasmModule._malloc(4);
+  let blockPtr = 0;
   
   try {
-    resultPtr = wasmModule._wasm_parse_plpgsql(queryPtr);
-    const resultStr = ptrToString(resultPtr);
-    
-    if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
-      throw new Error(resultStr);
+    blockPtr = mode === 'fast'
+      ? wasmModule._wasm_scan_fast(queryPtr, errorPtrPtr)
+      : wasmModule._wasm_scan_binary(queryPtr, errorPtrPtr);
+    probe?.returned();
+    if (!blockPtr) {
+      const errorPtr = wasmModule.getValue(errorPtrPtr, 'i32');
+      const message = errorPtr ? wasmModule.UTF8ToString(errorPtr) : 'Memory allocation failed';
+      if (errorPtr) {
+        wasmModule._wasm_free_string(errorPtr);
+      }
+      throw new Error(message);
     }
     
-    return JSON.parse(resultStr);
+    // Block layout: [version, count, start[count], end[count], tokenType[count], keywordKind[count]]
+    const version = wasmModule.getValue(blockPtr, 'i32');
+    const count = wasmModule.getValue(blockPtr + 4, 'i32');
+    const columns = new Int32Array(wasmModule.HEAPU8.buffer, blockPtr + 8, 4 * count).slice();
+    probe?.output(columns.byteLength + 8);
+    return new ScanBinaryResult(query, version, columns);
   } finally {
-    wasmModule._free(queryPtr);
-    if (resultPtr) {
-      wasmModule._wasm_free_string(resultPtr);
+    probe?.finish();
+    freeInput(queryPtr);
+    wasmModule._free(errorPtrPtr);
+    if (blockPtr) {
+      wasmModule._free(blockPtr);
     }
   }
 }
 
-export function fingerprintSync(query: string): string {
+// A scan block copied out whole, header included, as the native addon returns it
+function scanBlockResult(query: string, block: Int32Array): ScanBinaryResult {
+  return new ScanBinaryResult(query, block[0], block.subarray(2, 2 + 4 * block[1]));
+}
+
+export interface AnalyzeOptions {
+  parse?: boolean;
+  normalize?: boolean;
+  fingerprint?: boolean;
+  scan?: boolean;
+}
+
+export interface AnalyzeResult {
+  parseTree?: ParseResult;
+  normalized?: string;
+  fingerprint?: string;
+  scan?: ScanBinaryResult;
+}
+
+// Flags understood by wasm_analyze
+const ANALYZE_PARSE = 1;
+const ANALYZE_NORMALIZE = 2;
+const ANALYZE_FINGERPRINT = 4;
+const ANALYZE_SCAN = 8;
+
+export const analyze = awaitInit(async (query: string, options?: AnalyzeOptions): Promise<AnalyzeResult> => {
+  return analyzeSync(query, options);
+});
+
+// Bytes of the WasmAnalyzeResult read back for `result`, for stats
+function analyzeResultBytes(resultPtr: number, result: AnalyzeResult): number {
+  let bytes = 0;
+  for (const offset of [0, 4, 8]) {
+    const ptr = wasmModule.getValue(resultPtr + offset, 'i32');
+    bytes += ptr ? wasmModule.HEAPU8.indexOf(0, ptr) - ptr : 0;
+  }
+  return bytes + (result.scan ? result.scan.count * 16 + 8 : 0);
+}
+
+// parse, normalize, fingerprint and scanBinary from one raw parse in one WASM
+// call. Without options it returns the parse tree, normalized query and fingerprint.
+export function analyzeSync(
+  query: string,
+  options: AnalyzeOptions = { parse: true, normalize: true, fingerprint: true }
+): AnalyzeResult {
   if (!wasmModule) {
     throw new Error('WASM module not initialized. Call loadModule() first.');
   }
+
+  const flags = (options.parse ? ANALYZE_PARSE : 0) |
+    (options.normalize ? ANALYZE_NORMALIZE : 0) |
+    (options.fingerprint ? ANALYZE_FINGERPRINT : 0) |
+    (options.scan ? ANALYZE_SCAN : 0);
+  if (nativeAddon) {
+    return callNative('analyze', query, (addon) => addon.analyze(query, flags), (raw) => {
+      const result: AnalyzeResult = {};
+      let bytes = 0;
+      if (raw.parseTree !== undefined) {
+        result.parseTree = JSON.parse(raw.parseTree);
+        bytes += utf8Length(raw.parseTree);
+      }
+      if (raw.normalized !== undefined) {
+        result.normalized = raw.normalized;
+        bytes += utf8Length(raw.normalized);
+      }
+      if (raw.fingerprint !== undefined) {
+        result.fingerprint = raw.fingerprint;
+        bytes += raw.fingerprint.length;
+      }
+      if (raw.scan) {
+        result.scan = scanBlockResult(query, raw.scan);
+        bytes += raw.scan.byteLength;
+      }
+      return [result, bytes];
+    });
+  }
+  const probe = stats && new CallProbe(stats, 'analyze');
   const queryPtr = stringToPtr(query);
+  probe?.input(wasmModule.lengthBytesUTF8(query));
   let resultPtr = 0;
-  
+
   try {
-    resultPtr = wasmModule._wasm_fingerprint(queryPtr);
-    const resultStr = ptrToString(resultPtr);
-    
-    if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
-      throw new Error(resultStr);
+    resultPtr = wasmModule._wasm_analyze(queryPtr, flags);
+    probe?.returned();
+    if (!resultPtr) {
+      throw new Error('Failed to analyze query: memory allocation failed');
     }
-    
-    return resultStr;
+
+    // WasmAnalyzeResult: parse_tree 0, normalized_query 4, fingerprint_str 8, scan 12, error 16
+    const errorPtr = wasmModule.getValue(resultPtr + 16, 'i32');
+    if (errorPtr) {
+      throw readSqlError(errorPtr);
+    }
+
+    const result: AnalyzeResult = {};
+    if (options.parse) {
+      result.parseTree = JSON.parse(wasmModule.UTF8ToString(wasmModule.getValue(resultPtr, 'i32')));
+    }
+    if (options.normalize) {
+      result.normalized = wasmModule.UTF8ToString(wasmModule.getValue(resultPtr + 4, 'i32'));
+    }
+    if (options.fingerprint) {
+      result.fingerprint = wasmModule.UTF8ToString(wasmModule.getValue(resultPtr + 8, 'i32'));
+    }
+    if (options.scan) {
+      const blockPtr = wasmModule.getValue(resultPtr + 12, 'i32');
+      const version = wasmModule.getValue(blockPtr, 'i32');
+      const count = wasmModule.getValue(blockPtr + 4, 'i32');
+      const columns = new Int32Array(wasmModule.HEAPU8.buffer, blockPtr + 8, 4 * count).slice();
+      result.scan = new ScanBinaryResult(query, version, columns);
+    }
+    probe?.output(analyzeResultBytes(resultPtr, result));
+    return result;
   } finally {
-    wasmModule._free(queryPtr);
+    probe?.finish();
+    freeInput(queryPtr);
     if (resultPtr) {
-      wasmModule._wasm_free_string(resultPtr);
+      wasmModule._wasm_free_analyze_result(resultPtr);
     }
   }
 }
 
-export function normalizeSync(query: string): string {
+export type ReferenceAccess =
+  'select' | 'insert' | 'update' | 'delete' | 'merge' | 'truncate' | 'create' | 'alter' | 'drop' | 'other';
+
+export interface RelationReference {
+  schema?: string;
+  relation: string;
+  alias?: string;
+  access: ReferenceAccess;
+  location: number;   // UTF-8 byte offset, as in parse trees; -1 where the statement has none (DROP)
+  statement: number;  // Index into References.statements
+}
+
+export interface FunctionReference {
+  schema?: string;
+  name: string;
+  location: number;
+  statement: number;
+}
+
+export interface StatementReference {
+  type: string;       // Parse tree node name, e.g. 'SelectStmt', or 'Other'
+  location: number;   // UTF-8 byte offset and length of the statement
+  length: number;
+}
+
+export interface References {
+  statements: StatementReference[];
+  relations: RelationReference[];
+  functions: FunctionReference[];
+}
+
+// Indexed by the ACCESS_* values in references.c
+const REFERENCE_ACCESS: ReferenceAccess[] = [
+  'select', 'insert', 'update', 'delete', 'merge', 'truncate', 'create', 'alter', 'drop', 'other'
+];
+
+export const extractReferences = awaitInit(async (query: string): Promise<References> => {
+  return extractReferencesSync(query);
+});
+
+// Tables and functions a query uses, collected by walking the raw parse tree
+// inside WASM; no parse tree is built in JS. References to CTEs are left out.
+export function extractReferencesSync(query: string): References {
   if (!wasmModule) {
     throw new Error('WASM module not initialized. Call loadModule() first.');
   }
+
+  if (nativeAddon) {
+    return callNative('extractReferences', query, (addon) => addon.extractReferences(query), (buffer) => {
+      return [decodeReferences(new Uint8Array(buffer), utf8Length(query))[0], buffer.byteLength];
+    });
+  }
+
+  const probe = stats && new CallProbe(stats, 'extractReferences');
   const queryPtr = stringToPtr(query);
+  const queryBytes = wasmModule.lengthBytesUTF8(query);
+  probe?.input(queryBytes);
   let resultPtr = 0;
-  
+
   try {
-    resultPtr = wasmModule._wasm_normalize_query(queryPtr);
-    const resultStr = ptrToString(resultPtr);
-    
-    if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
-      throw new Error(resultStr);
+    resultPtr = wasmModule._wasm_extract_references(queryPtr);
+    probe?.returned();
+    if (!resultPtr) {
+      throw new Error('Failed to extract references: memory allocation failed');
     }
-    
-    return resultStr;
+
+    // WasmReferencesResult: block 0, error 4
+    const errorPtr = wasmModule.getValue(resultPtr + 4, 'i32');
+    if (errorPtr) {
+      throw readSqlError(errorPtr);
+    }
+
+    // Block layout: see references.c
+    const blockPtr = wasmModule.getValue(resultPtr, 'i32');
+    const [references, bytes] = decodeReferences(wasmModule.HEAPU8.subarray(blockPtr), queryBytes);
+    probe?.output(bytes);
+    return references;
   } finally {
-    wasmModule._free(queryPtr);
+    probe?.finish();
+    freeInput(queryPtr);
     if (resultPtr) {
-      wasmModule._wasm_free_string(resultPtr);
+      wasmModule._wasm_free_references_result(resultPtr);
     }
   }
 }
 
-export const scan = awaitInit(async (query: string): Promise<ScanResult> => {
-  const queryPtr = stringToPtr(query);
-  let resultPtr = 0;
-  
-  try {
-    resultPtr = wasmModule._wasm_scan(queryPtr);
-    const resultStr = ptrToString(resultPtr);
-    
-    if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
-      throw new Error(resultStr);
+// Words before the records in a references block; see references.c
+const REFERENCES_HEADER_WORDS = 5;
+
+// Decodes a references block starting at block[0]; returns the references
+// and the size of the block
+function decodeReferences(block: Uint8Array, queryBytes: number): [References, number] {
+  const [relationCount, functionCount, statementCount, stringsOffset, blockSize] =
+    new Int32Array(block.buffer, block.byteOffset, REFERENCES_HEADER_WORDS);
+  const words = new Int32Array(block.buffer, block.byteOffset + 4 * REFERENCES_HEADER_WORDS,
+    6 * relationCount + 4 * functionCount + 3 * statementCount);
+  const text = (offset: number) => {
+    if (offset < 0) {
+      return undefined;
     }
-    
-    return JSON.parse(resultStr);
-  } finally {
-    wasmModule._free(queryPtr);
-    if (resultPtr) {
-      wasmModule._wasm_free_string(resultPtr);
+    const start = stringsOffset + offset;
+    return utf8Decoder.decode(block.subarray(start, block.indexOf(0, start)));
+  };
+
+  const references: References = { statements: [], relations: [], functions: [] };
+  let i = 0;
+  for (let n = 0; n < relationCount; n++, i += 6) {
+    const relation: RelationReference = {
+      relation: text(words[i + 1])!,
+      access: REFERENCE_ACCESS[words[i + 3]],
+      location: words[i + 4],
+      statement: words[i + 5]
+    };
+    if (words[i] >= 0) {
+      relation.schema = text(words[i]);
     }
+    if (words[i + 2] >= 0) {
+      relation.alias = text(words[i + 2]);
+    }
+    references.relations.push(relation);
   }
-});
+  for (let n = 0; n < functionCount; n++, i += 4) {
+    const fn: FunctionReference = { name: text(words[i + 1])!, location: words[i + 2], statement: words[i + 3] };
+    if (words[i] >= 0) {
+      fn.schema = text(words[i]);
+    }
+    references.functions.push(fn);
+  }
+  for (let n = 0; n < statementCount; n++, i += 3) {
+    const location = words[i + 1];
+    // A zero length runs to the end of the input, as in RawStmt
+    references.statements.push({ type: text(words[i])!, location, length: words[i + 2] || queryBytes - location });
+  }
+  return [references, blockSize];
+}
 
-export function scanSync(query: string): ScanResult {
-  if (!wasmModule) {
-    throw new Error('WASM module not initialized. Call loadModule() first.');
+// Splits NUL-terminated UTF-8 bytes with libpg_query's scanner; returns the
+// [location, length] byte spans and where the scanner failed, or -1. After a
+// failure only the statements ending with a semicolon before it are listed.
+function splitStatementBytes(bytes: Uint8Array): [Int32Array, number] {
+  if (nativeAddon) {
+    let block: Int32Array;
+    try {
+      block = nativeAddon.splitStatements(bytes);
+    } catch (error) {
+      throw nativeError(error);
+    }
+    return [block.subarray(2, 2 + 2 * block[0]), block[1]];
   }
-  const queryPtr = stringToPtr(query);
-  let resultPtr = 0;
-  
+  const inputPtr = wasmModule._malloc(bytes.length + 1);
+  const errorPtrPtr = wasmModule._malloc(4);
+  let blockPtr = 0;
+
   try {
-    resultPtr = wasmModule._wasm_scan(queryPtr);
-    const resultStr = ptrToString(resultPtr);
-    
-    if (resultStr.startsWith('syntax error') || resultStr.startsWith('deparse error') || resultStr.startsWith('ERROR')) {
-      throw new Error(resultStr);
+    wasmModule.HEAPU8.set(bytes, inputPtr);
+    wasmModule.HEAPU8[inputPtr + bytes.length] = 0;
+
+    blockPtr = wasmModule._wasm_split_statements(inputPtr, errorPtrPtr);
+    if (!blockPtr) {
+      const errorPtr = wasmModule.getValue(errorPtrPtr, 'i32');
+      const message = errorPtr ? wasmModule.UTF8ToString(errorPtr) : 'Memory allocation failed';
+      if (errorPtr) {
+        wasmModule._wasm_free_string(errorPtr);
+      }
+      throw new Error(message);
     }
-    
-    return JSON.parse(resultStr);
+
+    const count = wasmModule.getValue(blockPtr, 'i32');
+    const errorAt = wasmModule.getValue(blockPtr + 4, 'i32');
+    return [new Int32Array(wasmModule.HEAPU8.buffer, blockPtr + 8, 2 * count).slice(), errorAt];
   } finally {
-    wasmModule._free(queryPtr);
-    if (resultPtr) {
-      wasmModule._wasm_free_string(resultPtr);
+    wasmModule._free(inputPtr);
+    wasmModule._free(errorPtrPtr);
+    if (blockPtr) {
+      wasmModule._free(blockPtr);
     }
   }
-} 
\ No newline at end of file
+}
+
+const SEMICOLON = 0x3b;
+const NEWLINE = 0x0a;
+const RETURN = 0x0d;
+const BACKSLASH = 0x5c;
+const PERIOD = 0x2e;
+
+// Leading whitespace and comments, as split statements keep them
+const COPY_FROM_STDIN = /^(?:\s+|--[^\n]*(?:\n|$)|\/\*[\s\S]*?\*\/)*copy\b[\s\S]*\bfrom\s+stdin\b/i;
+
+// Statements are rescanned from the start of the unfinished one, so past this
+// size the stream waits for it to double before scanning again
+const RESCAN_BYTES = 64 * 1024;
+const DEFAULT_MAX_STATEMENT_BYTES = 64 * 1024 * 1024;
+
+export interface StreamOptions {
+  /**
+   * Largest unfinished statement to hold while waiting for its end, in bytes.
+   * Past it the stream throws instead of buffering without bound. Default 64 MiB.
+   */
+  maxStatementBytes?: number;
+}
+
+// Yields the complete statements in `pending` and returns how many bytes they
+// used, and whether the last one was a COPY ... FROM stdin whose data follows.
+// Until the stream ends, the last statement only counts once its semicolon has
+// arrived, and a scanner error (an unterminated string or comment, perhaps cut
+// by a chunk boundary, or COPY data) just means more input is needed after the
+// statements before it.
+function* takeStatements(pending: Uint8Array, offset: number, final: boolean): Generator<SqlStatement, [number, boolean]> {
+  const [spans, errorAt] = splitStatementBytes(pending);
+
+  let consumed = 0;
+  for (let i = 0; i < spans.length; i += 2) {
+    const location = spans[i];
+    const length = spans[i + 1] || pending.length - location;
+    const end = location + length;
+
+    if (!final && i + 2 === spans.length && pending[end] !== SEMICOLON) {
+      break;
+    }
+    const sql = utf8Decoder.decode(pending.subarray(location, end));
+    yield { location: offset + location, length, sql };
+    consumed = pending[end] === SEMICOLON ? end + 1 : end;
+
+    // The data is not SQL, so stop here and let the caller skip it
+    if (COPY_FROM_STDIN.test(sql)) {
+      return [consumed, true];
+    }
+  }
+
+  if (final && errorAt >= 0) {
+    // The parser reports the scanner's error, with its position
+    parseSync(utf8Decoder.decode(pending.subarray(consumed)));
+    throw new Error(`Unterminated string or comment at byte ${offset + errorAt}`);
+  }
+  return [consumed, false];
+}
+
+// Returns where the `\.` line ending COPY data finishes in `data`, or -1
+function copyDataEnd(data: Uint8Array): number {
+  for (let i = data.indexOf(NEWLINE); i >= 0; i = data.indexOf(NEWLINE, i + 1)) {
+    if (data[i + 1] !== BACKSLASH || data[i + 2] !== PERIOD) {
+      continue;
+    }
+    if (data[i + 3] === NEWLINE) {
+      return i + 4;
+    }
+    if (data[i + 3] === RETURN && data[i + 4] === NEWLINE) {
+      return i + 5;
+    }
+  }
+  return -1;
+}
+
+// Splits a stream of SQL text into statements as chunks arrive, holding at most
+// the current unfinished statement in memory. Accepts any (async) iterable of
+// strings or bytes, such as a Node Readable. The data blocks that follow
+// COPY ... FROM stdin are skipped.
+export async function* splitStatementsStream(
+  source: AsyncIterable<string | Uint8Array> | Iterable<string | Uint8Array>,
+  options: StreamOptions = {}
+): AsyncGenerator<SqlStatement> {
+  await init();
+
+  const maxStatementBytes = options.maxStatementBytes ?? DEFAULT_MAX_STATEMENT_BYTES;
+
+  // buffer[start, end) is the unfinished input, which begins at `offset` in the
+  // stream: always at a statement boundary or inside COPY data
+  let buffer = new Uint8Array(RESCAN_BYTES);
+  let start = 0;
+  let end = 0;
+  let offset = 0;
+  let copyData = false;
+  let newSemicolon = false;
+  let scanAt = 0;
+
+  const append = (bytes: Uint8Array) => {
+    const size = end - start;
+    if (end + bytes.length > buffer.length) {
+      if (size + bytes.length > buffer.length) {
+        const grown = new Uint8Array(Math.max(2 * buffer.length, size + bytes.length));
+        grown.set(buffer.subarray(start, end));
+        buffer = grown;
+      } else {
+        buffer.copyWithin(0, start, end);
+      }
+      start = 0;
+      end = size;
+    }
+    buffer.set(bytes, end);
+    end += bytes.length;
+  };
+
+  const consume = (count: number) => {
+    start += count;
+    offset += count;
+  };
+
+  function* drain(final: boolean): Generator<SqlStatement> {
+    for (;;) {
+      if (copyData) {
+        const data = buffer.subarray(start, end);
+        const dataEnd = copyDataEnd(data);
+        if (dataEnd < 0) {
+          // Keep enough to find a terminator split across chunks
+          consume(final ? data.length : Math.max(0, data.length - 4));
+          return;
+        }
+        consume(dataEnd);
+        copyData = false;
+        newSemicolon = buffer.subarray(start, end).includes(SEMICOLON);
+      }
+
+      const pending = buffer.subarray(start, end);
+      if (final) {
+        if (!pending.some((byte) => byte > 0x20)) {
+          return;
+        }
+      } else if (!newSemicolon || (pending.length < scanAt && pending.length <= maxStatementBytes)) {
+        // No statement can end without a new semicolon
+        break;
+      }
+
+      newSemicolon = false;
+      const [consumed, copy] = yield* takeStatements(pending, offset, final);
+      consume(consumed);
+      copyData = copy;
+      if (!copy) {
+        const remaining = end - start;
+        scanAt = remaining < RESCAN_BYTES ? 0 : 2 * remaining;
+        break;
+      }
+    }
+
+    if (end - start > maxStatementBytes) {
+      throw new Error(
+        `No statement ends within maxStatementBytes (${maxStatementBytes}) of byte ${offset}: ` +
+        'the statement is too long, or has an unterminated string or comment'
+      );
+    }
+  }
+
+  for await (const chunk of source) {
+    let bytes: Uint8Array;
+    if (typeof chunk === 'string') {
+      bytes = utf8Encoder.encode(chunk);
+    } else if (chunk instanceof Uint8Array) {
+      bytes = chunk;
+    } else {
+      throw new TypeError(`Expected string or Uint8Array chunks, got ${typeof chunk}`);
+    }
+
+    append(bytes);
+    newSemicolon = newSemicolon || bytes.includes(SEMICOLON);
+    yield* drain(false);
+  }
+
+  yield* drain(true);
+}
+
+// splitStatementsStream, with each statement parsed as it is split
+export async function* parseStream(
+  source: AsyncIterable<string | Uint8Array> | Iterable<string | Uint8Array>,
+  options: StreamOptions = {}
+): AsyncGenerator<ParsedStatement> {
+  for await (const statement of splitStatementsStream(source, options)) {
+    yield { ...statement, parseTree: parseSync(statement.sql) };
+  }
+}
+
+export const parsePlPgSQLDump = awaitInit(async (dump: string | Uint8Array): Promise<PlPgSQLFunction[]> => {
+  return parsePlPgSQLDumpSync(dump);
+});
+
+// Finds every CREATE FUNCTION/PROCEDURE ... LANGUAGE plpgsql in a schema dump
+// and parses them all in one WASM call. Each function is parsed on its own, so
+// one that fails is reported in its entry instead of failing the dump.
+export function parsePlPgSQLDumpSync(dump: string | Uint8Array): PlPgSQLFunction[] {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  if (typeof dump === 'string') {
+    dump = utf8Encoder.encode(dump);
+  } else if (!(dump instanceof Uint8Array)) {
+    throw new TypeError(`Expected a string or Uint8Array, got ${typeof dump}`);
+  }
+  if (dump.includes(0)) {
+    throw new Error('Dump cannot contain NUL characters');
+  }
+  return parsePlPgSQLBytes(dump);
+}
+
+// sizeof(WasmPlpgsqlFunction):
+// { int32_t location; int32_t length; char* plpgsql_funcs; char* error; int32_t cursorpos; }
+const PLPGSQL_FUNCTION_SIZE = 20;
+
+function parsePlPgSQLBytes(bytes: Uint8Array): PlPgSQLFunction[] {
+  if (nativeAddon) {
+    return callNative('parsePlPgSQLDump', bytes, (addon) => addon.parsePlPgSQLDump(bytes), (found) => {
+      let output = 0;
+      const functions = found.map(([location, length, json, message, cursorpos]): PlPgSQLFunction => {
+        const sql = utf8Decoder.decode(bytes.subarray(location, location + length));
+        if (json !== null) {
+          output += json.length;
+          return { location, length, sql, parseTree: JSON.parse(`{"plpgsql_funcs":${json}}`) };
+        }
+        return { location, length, sql, error: { message: message!, cursorPosition: cursorpos > 0 ? cursorpos - 1 : 0 } };
+      });
+      return [functions, output];
+    });
+  }
+  const probe = stats && new CallProbe(stats, 'parsePlPgSQLDump');
+  const inputPtr = wasmModule._malloc(bytes.length + 1);
+  const errorPtrPtr = wasmModule._malloc(4);
+  probe?.input(bytes.length);
+  let resultPtr = 0;
+
+  try {
+    wasmModule.HEAPU8.set(bytes, inputPtr);
+    wasmModule.HEAPU8[inputPtr + bytes.length] = 0;
+
+    resultPtr = wasmModule._wasm_parse_plpgsql_dump(inputPtr, errorPtrPtr);
+    probe?.returned();
+    if (!resultPtr) {
+      const errorPtr = wasmModule.getValue(errorPtrPtr, 'i32');
+      const message = errorPtr ? wasmModule.UTF8ToString(errorPtr) : 'Memory allocation failed';
+      if (errorPtr) {
+        wasmModule._wasm_free_string(errorPtr);
+      }
+      throw new Error(message);
+    }
+
+    // WasmPlpgsqlDumpResult: count 0, functions 4
+    const count = wasmModule.getValue(resultPtr, 'i32');
+    const functionsPtr = wasmModule.getValue(resultPtr + 4, 'i32');
+    const functions: PlPgSQLFunction[] = new Array(count);
+    let output = 0;
+    for (let i = 0; i < count; i++) {
+      const functionPtr = functionsPtr + i * PLPGSQL_FUNCTION_SIZE;
+      const location = wasmModule.getValue(functionPtr, 'i32');
+      const length = wasmModule.getValue(functionPtr + 4, 'i32');
+      const funcsPtr = wasmModule.getValue(functionPtr + 8, 'i32');
+      const sql = utf8Decoder.decode(bytes.subarray(location, location + length));
+
+      if (funcsPtr) {
+        const json = wasmModule.UTF8ToString(funcsPtr);
+        output += json.length;
+        functions[i] = { location, length, sql, parseTree: JSON.parse(`{"plpgsql_funcs":${json}}`) };
+      } else {
+        const message = wasmModule.UTF8ToString(wasmModule.getValue(functionPtr + 12, 'i32'));
+        const cursorpos = wasmModule.getValue(functionPtr + 16, 'i32');
+        functions[i] = { location, length, sql, error: { message, cursorPosition: cursorpos > 0 ? cursorpos - 1 : 0 } };
+      }
+    }
+
+    probe?.output(output);
+    return functions;
+  } finally {
+    probe?.finish();
+    wasmModule._free(inputPtr);
+    wasmModule._free(errorPtrPtr);
+    if (resultPtr) {
+      wasmModule._wasm_free_plpgsql_dump(resultPtr);
+    }
+  }
+}
+
+// Statements gathered by parsePlPgSQLStream before they are parsed in one call
+const PLPGSQL_GROUP_BYTES = 1 << 20;
+
+// Same cheap test as may_define_plpgsql in wasm_wrapper.c
+function mayDefinePlPgSQL(sql: string): boolean {
+  return /plpgsql/i.test(sql) && /function|procedure/i.test(sql);
+}
+
+// Parses one group of statements from parsePlPgSQLStream, joined into a single
+// input, and maps the results back to their locations in the stream
+function* parsePlPgSQLGroup(group: SqlStatement[]): Generator<PlPgSQLFunction> {
+  const starts: number[] = [];
+  let offset = 0;
+  for (const statement of group) {
+    starts.push(offset);
+    offset += statement.length + 2;
+  }
+
+  let index = 0;
+  for (const fn of parsePlPgSQLBytes(utf8Encoder.encode(group.map((statement) => statement.sql).join(';\n')))) {
+    while (index + 1 < starts.length && fn.location >= starts[index] + group[index].length) {
+      index++;
+    }
+    yield { ...fn, location: group[index].location + fn.location - starts[index] };
+  }
+}
+
+// splitStatementsStream, yielding the PL/pgSQL functions defined in the stream
+// as parsePlPgSQLDump does. Candidate statements are parsed a group at a time,
+// so a dump of any size takes one WASM call per megabyte of function source.
+export async function* parsePlPgSQLStream(
+  source: AsyncIterable<string | Uint8Array> | Iterable<string | Uint8Array>,
+  options: StreamOptions = {}
+): AsyncGenerator<PlPgSQLFunction> {
+  let group: SqlStatement[] = [];
+  let bytes = 0;
+
+  for await (const statement of splitStatementsStream(source, options)) {
+    if (!mayDefinePlPgSQL(statement.sql)) {
+      continue;
+    }
+    group.push(statement);
+    bytes += statement.length;
+    if (bytes >= PLPGSQL_GROUP_BYTES) {
+      yield* parsePlPgSQLGroup(group);
+      group = [];
+      bytes = 0;
+    }
+  }
+
+  if (group.length > 0) {
+    yield* parsePlPgSQLGroup(group);
+  }
+}
+
+export interface SqlEdit {
+  /** Where the edit starts in the previous text, as a string index */
+  offset: number;
+  /** Number of characters removed at `offset` */
+  deleteLength: number;
+  /** Text inserted at `offset` */
+  insertText: string;
+}
+
+export interface IncrementalParseResult {
+  sql: string;
+  parseTree: ParseResult;
+  /** Index in parseTree.stmts of the first statement that was re-parsed */
+  reparsedStart: number;
+  /** Number of statements that came from re-parsing; the rest were reused */
+  reparsedCount: number;
+}
+
+let atomicToken: number | undefined;
+
+// Byte offset of the semicolon ending a RawStmt from parse()
+function statementEnd(raw: any): number {
+  return (raw.stmt_location ?? 0) + raw.stmt_len;
+}
+
+// Copies a parse tree node with every `location` moved by `delta`. Unknown
+// locations (-1) stay as they are, and zero locations are left out, as parse() does.
+function shiftLocations(value: any, delta: number): any {
+  if (Array.isArray(value)) {
+    return value.map((item) => shiftLocations(item, delta));
+  }
+  if (value === null || typeof value !== 'object') {
+    return value;
+  }
+  const out: any = {};
+  for (const key in value) {
+    const child = value[key];
+    if (key === 'location' && typeof child === 'number' && child >= 0) {
+      if (child + delta !== 0) {
+        out[key] = child + delta;
+      }
+    } else {
+      out[key] = shiftLocations(child, delta);
+    }
+  }
+  return out;
+}
+
+function shiftStatement(raw: any, location: number, length: number | undefined, delta: number): any {
+  const out: any = { stmt: shiftLocations(raw.stmt, delta) };
+  if (location) {
+    out.stmt_location = location;
+  }
+  if (length) {
+    out.stmt_len = length;
+  }
+  return out;
+}
+
+// Parses the bytes [start, end) of the new text as a run of whole statements.
+// The text is parsed with a leading space so that no node sits at offset 0,
+// where parse() would leave its location out. Returns null when `closed`
+// (the run should end with a statement's semicolon) does not hold for the new
+// text, so the caller has to take in more of it.
+function parseStatementRun(bytes: Uint8Array, start: number, end: number, closed: boolean): any[] | null {
+  const text = ' ' + utf8Decoder.decode(bytes.subarray(start, end));
+  let tokens: ScanBinaryResult | undefined;
+
+  if (closed) {
+    try {
+      tokens = scanToColumns(text, 'binary');
+    } catch {
+      // An unterminated string or comment now runs past the semicolon
+      return null;
+    }
+    const last = tokens.count - 1;
+    if (last < 0 || tokens.tokenType[last] !== SEMICOLON || tokens.end[last] !== 1 + end - start) {
+      return null;
+    }
+  }
+
+  let result: ParseResult;
+  try {
+    result = text.trim() ? parseSync(text) : ({} as ParseResult);
+  } catch (error) {
+    // A statement can only run on past its semicolon inside BEGIN ATOMIC ... END
+    if (tokens) {
+      if (atomicToken === undefined) {
+        atomicToken = Number(Object.keys(protoEnums.Token).find((key) => protoEnums.Token[key] === 'ATOMIC'));
+      }
+      if (tokens.tokenType.includes(atomicToken)) {
+        return null;
+      }
+    }
+    if (error instanceof SqlError && error.sqlDetails) {
+      const prefix = utf8Decoder.decode(bytes.subarray(0, start)).length;
+      throw new SqlError(error.message, {
+        ...error.sqlDetails,
+        cursorPosition: error.sqlDetails.cursorPosition - 1 + prefix
+      });
+    }
+    throw error;
+  }
+
+  // Only a statement at the very start of the run has no stmt_location; its
+  // length then includes the added space
+  return (result.stmts ?? []).map((raw: any) => raw.stmt_location
+    ? shiftStatement(raw, raw.stmt_location + start - 1, raw.stmt_len, start - 1)
+    : shiftStatement(raw, start, raw.stmt_len && raw.stmt_len - 1, start - 1));
+}
+
+export const reparse = awaitInit(async (
+  previous: Pick<IncrementalParseResult, 'sql' | 'parseTree'>,
+  edit: SqlEdit
+): Promise<IncrementalParseResult> => {
+  return reparseSync(previous, edit);
+});
+
+// Applies an edit to a previously parsed text and re-parses only the
+// statements it touches. The statements before it are reused as they are and
+// the ones after it have their locations shifted; the text re-parsed grows past
+// the edited statement only when the edit changes where statements end, such
+// as an opened string or a deleted semicolon.
+export function reparseSync(
+  previous: Pick<IncrementalParseResult, 'sql' | 'parseTree'>,
+  edit: SqlEdit
+): IncrementalParseResult {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+
+  const { offset, deleteLength, insertText } = edit;
+  const oldSql = previous.sql;
+  if (!(offset >= 0 && deleteLength >= 0 && offset + deleteLength <= oldSql.length)) {
+    throw new RangeError(`Edit [${offset}, ${offset + deleteLength}) is outside the previous text`);
+  }
+
+  const sql = oldSql.slice(0, offset) + insertText + oldSql.slice(offset + deleteLength);
+  const bytes = utf8Encoder.encode(sql);
+  const editStart = utf8Length(oldSql.slice(0, offset));
+  const editEnd = editStart + utf8Length(oldSql.slice(offset, offset + deleteLength));
+  const delta = utf8Length(insertText) - (editEnd - editStart);
+  const stmts: any[] = previous.parseTree.stmts ?? [];
+
+  // Statements whose semicolon comes before the edit are unaffected
+  let first = 0;
+  while (first < stmts.length && stmts[first].stmt_len && statementEnd(stmts[first]) < editStart) {
+    first++;
+  }
+  const start = first > 0 ? statementEnd(stmts[first - 1]) + 1 : 0;
+
+  // Re-parse up to the first semicolon at or after the end of the removed text,
+  // taking in twice as many following statements each time that is not enough
+  let last = first;
+  while (last < stmts.length && stmts[last].stmt_len && statementEnd(stmts[last]) < editEnd) {
+    last++;
+  }
+  let reparsed: any[] | null = null;
+  for (let step = 1; !reparsed; step *= 2) {
+    const closed = last < stmts.length && stmts[last].stmt_len > 0;
+    const end = closed ? statementEnd(stmts[last]) + 1 + delta : bytes.length;
+    reparsed = parseStatementRun(bytes, start, end, closed);
+    if (!reparsed) {
+      last = Math.min(last + step, stmts.length);
+    }
+  }
+
+  const following = stmts.slice(last + 1).map((raw) => delta
+    ? shiftStatement(raw, raw.stmt_location + delta, raw.stmt_len, delta)
+    : raw);
+  const parseTree: any = { version: previous.parseTree.version };
+  const all = [...stmts.slice(0, first), ...reparsed, ...following];
+  if (all.length) {
+    parseTree.stmts = all;
+  }
+
+  return { sql, parseTree, reparsedStart: first, reparsedCount: reparsed.length };
+}
+
+export const parseBatch = awaitInit(async (queries: string[]): Promise<ParseBatchItem[]> => {
+  return parseBatchSync(queries);
+});
+
+export function parseBatchSync(queries: string[]): ParseBatchItem[] {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  if (!Array.isArray(queries)) {
+    throw new TypeError(`Expected an array of strings, got ${typeof queries}`);
+  }
+
+  const items: ParseBatchItem[] = new Array(queries.length);
+  if (queries.length === 0) {
+    return items;
+  }
+
+  // Invalid entries get their error record up front and are packed as empty
+  // strings so every other query keeps its slot in the batch.
+  const inputs = queries.map((query, i) => {
+    if (typeof query !== 'string') {
+      throw new TypeError(`Expected a string at index ${i}, got ${typeof query}`);
+    }
+    if (query === '') {
+      items[i] = { error: new Error('Query cannot be empty') };
+      return '';
+    }
+    if (query.includes('\0')) {
+      items[i] = { error: new Error('Query cannot contain NUL characters') };
+      return '';
+    }
+    return query;
+  });
+
+  const packed = inputs.join('\0');
+  if (nativeAddon) {
+    return callNative('parseBatch', packed, (addon) => addon.parseBatch(packed, queries.length), (parsed) => {
+      let bytesOut = 0;
+      for (let i = 0; i < queries.length; i++) {
+        if (items[i]) continue;
+        const item = parsed[i];
+        if (item instanceof Error) {
+          items[i] = { error: nativeError(item) };
+        } else if (item === null) {
+          items[i] = { error: new Error('No parse tree generated') };
+        } else {
+          bytesOut += item.length;
+          items[i] = { result: JSON.parse(item) };
+        }
+      }
+      return [items, bytesOut];
+    });
+  }
+
+  const probe = stats && new CallProbe(stats, 'parseBatch');
+  const queriesPtr = stringToPtr(packed);
+  probe?.input(wasmModule.lengthBytesUTF8(packed));
+  let resultsPtr = 0;
+  let bytesOut = 0;
+
+  try {
+    resultsPtr = wasmModule._wasm_parse_batch(queriesPtr, queries.length);
+    probe?.returned();
+    if (!resultsPtr) {
+      throw new Error('Failed to parse batch: memory allocation failed');
+    }
+
+    for (let i = 0; i < queries.length; i++) {
+      if (items[i]) continue;
+
+      const resultPtr = resultsPtr + i * PARSE_RESULT_SIZE;
+      const parseTreePtr = wasmModule.getValue(resultPtr, 'i32');
+      const errorPtr = wasmModule.getValue(resultPtr + 8, 'i32');
+
+      if (errorPtr) {
+        items[i] = { error: readSqlError(errorPtr) };
+      } else if (!parseTreePtr) {
+        items[i] = { error: new Error('No parse tree generated') };
+      } else {
+        if (probe) {
+          bytesOut += wasmModule.HEAPU8.indexOf(0, parseTreePtr) - parseTreePtr;
+        }
+        items[i] = { result: JSON.parse(wasmModule.UTF8ToString(parseTreePtr)) };
+      }
+    }
+
+    probe?.output(bytesOut);
+    return items;
+  } finally {
+    probe?.finish();
+    freeInput(queriesPtr);
+    if (resultsPtr) {
+      wasmModule._wasm_free_parse_batch(resultsPtr, queries.length);
+    }
+  }
+}
+
+// sizeof(WasmValidateResult): { int32_t valid; int32_t cursorpos; char* message; }
+const VALIDATE_RESULT_SIZE = 12;
+
+const VALID: ValidationResult = Object.freeze({ valid: true });
+
+function invalid(message: string, cursorPosition: number): ValidationResult {
+  return { valid: false, error: { message, cursorPosition } };
+}
+
+export const validate = awaitInit(async (query: string): Promise<ValidationResult> => {
+  return validateSync(query);
+});
+
+export function validateSync(query: string): ValidationResult {
+  if (typeof query !== 'string') {
+    throw new TypeError(`Expected a string, got ${typeof query}`);
+  }
+  return validateBatchSync([query])[0];
+}
+
+export const validateBatch = awaitInit(async (queries: string[]): Promise<ValidationResult[]> => {
+  return validateBatchSync(queries);
+});
+
+// Syntax check only: libpg_query's raw parser runs, but no tree is serialized
+// or decoded. Invalid queries are reported in their result, never thrown.
+export function validateBatchSync(queries: string[]): ValidationResult[] {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  if (!Array.isArray(queries)) {
+    throw new TypeError(`Expected an array of strings, got ${typeof queries}`);
+  }
+
+  const count = queries.length;
+  const results: ValidationResult[] = new Array(count);
+  if (count === 0) {
+    return results;
+  }
+
+  // Same packing as parseBatch: rejected entries go in empty to keep their slot
+  const inputs = queries.map((query, i) => {
+    if (typeof query !== 'string') {
+      throw new TypeError(`Expected a string at index ${i}, got ${typeof query}`);
+    }
+    if (query === '') {
+      results[i] = invalid('Query cannot be empty', 0);
+      return '';
+    }
+    if (query.includes('\0')) {
+      results[i] = invalid('Query cannot contain NUL characters', query.indexOf('\0'));
+      return '';
+    }
+    return query;
+  });
+
+  const packed = inputs.join('\0');
+  if (nativeAddon) {
+    return callNative('validate', packed, (addon) => addon.validateBatch(packed, count), (validated) => {
+      for (let i = 0; i < count; i++) {
+        if (results[i]) {
+          continue;
+        }
+        const failure = validated[i];
+        results[i] = failure ? invalid(failure[0], failure[1] > 0 ? failure[1] - 1 : 0) : VALID;
+      }
+      return [results, count * VALIDATE_RESULT_SIZE];
+    });
+  }
+
+  const probe = stats && new CallProbe(stats, 'validate');
+  const queriesPtr = stringToPtr(packed);
+  probe?.input(wasmModule.lengthBytesUTF8(packed));
+  const outPtr = wasmModule._malloc(count * VALIDATE_RESULT_SIZE);
+  let failures = 0;
+
+  try {
+    failures = outPtr ? wasmModule._wasm_validate_batch(queriesPtr, count, outPtr) : -1;
+    probe?.returned();
+    if (failures < 0) {
+      throw new Error('Failed to validate batch: memory allocation failed');
+    }
+
+    for (let i = 0; i < count; i++) {
+      const resultPtr = outPtr + i * VALIDATE_RESULT_SIZE;
+      if (results[i]) {
+        continue;
+      }
+      if (wasmModule.getValue(resultPtr, 'i32')) {
+        results[i] = VALID;
+      } else {
+        const cursorpos = wasmModule.getValue(resultPtr + 4, 'i32');
+        const message = wasmModule.UTF8ToString(wasmModule.getValue(resultPtr + 8, 'i32'));
+        results[i] = invalid(message, cursorpos > 0 ? cursorpos - 1 : 0); // Convert to 0-based
+      }
+    }
+
+    probe?.output(count * VALIDATE_RESULT_SIZE);
+    return results;
+  } finally {
+    probe?.finish();
+    freeInput(queriesPtr);
+    if (outPtr) {
+      for (let i = 0; failures > 0 && i < count; i++) {
+        const messagePtr = wasmModule.getValue(outPtr + i * VALIDATE_RESULT_SIZE + 8, 'i32');
+        if (messagePtr) {
+          wasmModule._wasm_free_string(messagePtr);
+          failures--;
+        }
+      }
+      wasmModule._free(outPtr);
+    }
+  }
+}
+
+export const fingerprintBigInt = awaitInit(async (query: string): Promise<bigint> => {
+  return fingerprintBigIntSync(query);
+});
+
+export function fingerprintBigIntSync(query: string): bigint {
+  // Input validation
+  if (query === null || query === undefined) {
+    throw new Error('Query cannot be null or undefined');
+  }
+  
+  if (query === '') {
+    throw new Error('Query cannot be empty');
+  }
+
+  const [fingerprint] = fingerprintBatchSync([query]);
+  if (fingerprint === 0n) {
+    // Failures carry no message through the batch call; rerun for the error
+    fingerprintUncached(query);
+    throw new Error('Failed to fingerprint query');
+  }
+  return fingerprint;
+}
+
+export const fingerprintBatch = awaitInit(async (queries: string[], out?: BigUint64Array): Promise<BigUint64Array> => {
+  return fingerprintBatchSync(queries, out);
+});
+
+// Writes the raw 64-bit fingerprint of each query to `out` (allocated when not
+// given), with 0 for queries that fail to parse
+export function fingerprintBatchSync(queries: string[], out?: BigUint64Array): BigUint64Array {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  if (!Array.isArray(queries)) {
+    throw new TypeError(`Expected an array of strings, got ${typeof queries}`);
+  }
+
+  const count = queries.length;
+  if (out === undefined) {
+    out = new BigUint64Array(count);
+  } else if (!(out instanceof BigUint64Array) || out.length < count) {
+    throw new RangeError(`Expected a BigUint64Array with room for ${count} fingerprints`);
+  }
+  if (count === 0) {
+    return out;
+  }
+
+  // Queries with embedded NULs would split the packed buffer; pack them empty so they fail in place
+  const inputs = queries.map((query, i) => {
+    if (typeof query !== 'string') {
+      throw new TypeError(`Expected a string at index ${i}, got ${typeof query}`);
+    }
+    return query.includes('\0') ? '' : query;
+  });
+
+  const packed = inputs.join('\0');
+  if (nativeAddon) {
+    return callNative('fingerprintBatch', packed, (addon) => addon.fingerprintBatch(packed, count), (fingerprints) => {
+      out!.set(fingerprints);
+      return [out!, count * 8];
+    });
+  }
+
+  const probe = stats && new CallProbe(stats, 'fingerprintBatch');
+  const queriesPtr = stringToPtr(packed);
+  probe?.input(wasmModule.lengthBytesUTF8(packed));
+  const outPtr = wasmModule._malloc(count * 8);
+
+  try {
+    const status = outPtr ? wasmModule._wasm_fingerprint_batch(queriesPtr, count, outPtr) : -1;
+    probe?.returned();
+    if (status < 0) {
+      throw new Error('Failed to fingerprint batch: memory allocation failed');
+    }
+    out.set(new BigUint64Array(wasmModule.HEAPU8.buffer, outPtr, count));
+    probe?.output(count * 8);
+    return out;
+  } finally {
+    probe?.finish();
+    freeInput(queriesPtr);
+    if (outPtr) {
+      wasmModule._free(outPtr);
+    }
+  }
+}
+
+export const parseProtobuf = awaitInit(async (query: string): Promise<Uint8Array> => {
+  return parseProtobufSync(query);
+});
+
+export function parseProtobufSync(query: string): Uint8Array {
+  if (!wasmModule) {
+    throw new Error('WASM module not initialized. Call loadModule() first.');
+  }
+  
+  // Input validation
+  if (query === null || query === undefined) {
+    throw new Error('Query cannot be null or undefined');
+  }
+  
+  if (query === '') {
+    throw new Error('Query cannot be empty');
+  }
+
+  if (nativeAddon) {
+    return callNative('parseProtobuf', query, (addon) => addon.parseProtobuf(query), (buffer) => [buffer, buffer.length]);
+  }
+
+  const probe = stats && new CallProbe(stats, 'parseProtobuf');
+  const queryPtr = stringToPtr(query);
+  probe?.input(wasmModule.lengthBytesUTF8(query));
+  let resultPtr = 0;
+  
+  try {
+    resultPtr = wasmModule._wasm_parse_query_protobuf_raw(queryPtr);
+    probe?.returned();
+    if (!resultPtr) {
+      throw new Error('Failed to parse query: memory allocation failed');
+    }
+    
+    // Read the PgQueryProtobufParseResult struct
+    // struct { PgQueryProtobuf parse_tree { size_t len; char* data; }; char* stderr_buffer; PgQueryError* error; }
+    const dataLen = wasmModule.getValue(resultPtr, 'i32');
+    const dataPtr = wasmModule.getValue(resultPtr + 4, 'i32');
+    const errorPtr = wasmModule.getValue(resultPtr + 12, 'i32');
+    
+    if (errorPtr) {
+      throw readSqlError(errorPtr);
+    }
+    
+    // The one copy out of the heap; a view would not survive the free below
+    const buffer = wasmModule.HEAPU8.slice(dataPtr, dataPtr + dataLen);
+    probe?.output(dataLen);
+    return buffer;
+  } finally {
+    probe?.finish();
+    freeInput(queryPtr);
+    if (resultPtr) {
+      wasmModule._wasm_free_protobuf_parse_result(resultPtr);
+    }
+  }
+}
+
+// Protobuf decoding: builds the same plain objects JSON.parse produces, reading
+// the wire format directly against the field table in proto-schema.js
+
+interface ProtoFieldSpec {
+  number: number;
+  key: string;
+  type: string;
+  repeated: boolean;
+}
+
+const protoFieldSpecs = new Map<string, ProtoFieldSpec[]>();
+const protoKeySpecs = new Map<string, Map<string, ProtoFieldSpec>>();
+const protoEnumValues = new Map<string, Record<string, number>>();
+
+// Indexed by field number, for decoding
+function getProtoFieldSpecs(typeName: string): ProtoFieldSpec[] {
+  let specs = protoFieldSpecs.get(typeName);
+  if (!specs) {
+    specs = [];
+    for (const [fieldNumber, key, type, repeated] of protoMessages[typeName]) {
+      specs[fieldNumber] = { number: fieldNumber, key, type, repeated: repeated === 1 };
+    }
+    protoFieldSpecs.set(typeName, specs);
+  }
+  return specs;
+}
+
+// Keyed by AST property name, for encoding
+function getProtoKeySpecs(typeName: string): Map<string, ProtoFieldSpec> {
+  let specs = protoKeySpecs.get(typeName);
+  if (!specs) {
+    specs = new Map();
+    for (const spec of getProtoFieldSpecs(typeName)) {
+      if (spec) {
+        specs.set(spec.key, spec);
+      }
+    }
+    protoKeySpecs.set(typeName, specs);
+  }
+  return specs;
+}
+
+function getProtoEnumValues(typeName: string): Record<string, number> {
+  let values = protoEnumValues.get(typeName);
+  if (!values) {
+    values = {};
+    for (const [value, name] of Object.entries(protoEnums[typeName] as Record<string, string>)) {
+      values[name] = Number(value);
+    }
+    protoEnumValues.set(typeName, values);
+  }
+  return values;
+}
+
+const PROTO_VARINT_TYPES = new Set(['int32', 'uint32', 'int64', 'uint64', 'bool']);
+
+const utf8Decoder = new TextDecoder();
+
+class ProtobufReader {
+  private view?: DataView;
+
+  constructor(readonly buf: Uint8Array, public pos = 0) {}
+
+  // Low 32 bits of a varint; longer encodings (negative int32) are consumed whole
+  uint32(): number {
+    let value = 0;
+    let shift = 0;
+    let byte: number;
+    do {
+      byte = this.buf[this.pos++];
+      if (shift < 32) {
+        value |= (byte & 0x7f) << shift;
+      }
+      shift += 7;
+    } while (byte & 0x80);
+    return value >>> 0;
+  }
+
+  // 64-bit varint as a Number (exact up to 2^53)
+  uint64(): number {
+    let value = 0;
+    let scale = 1;
+    let byte: number;
+    do {
+      byte = this.buf[this.pos++];
+      value += (byte & 0x7f) * scale;
+      scale *= 128;
+    } while (byte & 0x80);
+    return value;
+  }
+
+  double(): number {
+    if (!this.view) {
+      this.view = new DataView(this.buf.buffer, this.buf.byteOffset, this.buf.byteLength);
+    }
+    const value = this.view.getFloat64(this.pos, true);
+    this.pos += 8;
+    return value;
+  }
+
+  string(): string {
+    const len = this.uint32();
+    const start = this.pos;
+    this.pos += len;
+
+    // Identifiers and keywords are short ASCII; skip the TextDecoder call for them
+    if (len <= 32) {
+      let ascii = '';
+      for (let i = start; i < this.pos; i++) {
+        const c = this.buf[i];
+        if (c & 0x80) {
+          return utf8Decoder.decode(this.buf.subarray(start, this.pos));
+        }
+        ascii += String.fromCharCode(c);
+      }
+      return ascii;
+    }
+    return utf8Decoder.decode(this.buf.subarray(start, this.pos));
+  }
+
+  skip(wireType: number) {
+    switch (wireType) {
+      case 0: this.uint64(); break;
+      case 1: this.pos += 8; break;
+      case 2: {
+        const len = this.uint32();
+        this.pos += len;
+        break;
+      }
+      case 5: this.pos += 4; break;
+      default: throw new Error(`Unsupported protobuf wire type ${wireType}`);
+    }
+  }
+}
+
+type ProtoMessageDecoder = (reader: ProtobufReader, end: number, typeName: string) => any;
+
+function decodeProtoValue(reader: ProtobufReader, type: string, decodeMessage: ProtoMessageDecoder): any {
+  switch (type) {
+    case 'string': return reader.string();
+    case 'bool': return reader.uint32() !== 0;
+    case 'int32': return reader.uint32() | 0;
+    case 'uint32': return reader.uint32();
+    case 'int64':
+    case 'uint64': return reader.uint64();
+    case 'double': return reader.double();
+  }
+
+  const enumValues = protoEnums[type];
+  if (enumValues) {
+    const value = reader.uint32();
+    return enumValues[value] ?? value;
+  }
+
+  const end = reader.uint32() + reader.pos;
+  return decodeMessage(reader, end, type);
+}
+
+function decodeProtoRepeated(reader: ProtobufReader, wireType: number, spec: ProtoFieldSpec, values: any[], decodeMessage: ProtoMessageDecoder) {
+  if (wireType === 2 && PROTO_VARINT_TYPES.has(spec.type)) {
+    // Packed repeated scalars
+    const packedEnd = reader.uint32() + reader.pos;
+    while (reader.pos < packedEnd) {
+      values.push(decodeProtoValue(reader, spec.type, decodeMessage));
+    }
+  } else {
+    values.push(decodeProtoValue(reader, spec.type, decodeMessage));
+  }
+}
+
+// Fields the JSON output always writes, even where protobuf omits the default
+function applyJsonDefaults(typeName: string, result: any) {
+  switch (typeName) {
+    case 'ParseResult':
+      if (!('stmts' in result)) result.stmts = [];
+      break;
+    case 'String':
+      if (!('sval' in result)) result.sval = '';
+      break;
+    case 'BitString':
+      if (!('bsval' in result)) result.bsval = '';
+      break;
+  }
+}
+
+function decodeProtoMessage(reader: ProtobufReader, end: number, typeName: string): any {
+  const specs = getProtoFieldSpecs(typeName);
+  const result: any = {};
+
+  while (reader.pos < end) {
+    const tag = reader.uint32();
+    const spec = specs[tag >>> 3];
+    const wireType = tag & 7;
+
+    if (!spec) {
+      reader.skip(wireType);
+      continue;
+    }
+
+    if (spec.repeated) {
+      const values = result[spec.key] || (result[spec.key] = []);
+      decodeProtoRepeated(reader, wireType, spec, values, decodeProtoMessage);
+    } else {
+      result[spec.key] = decodeProtoValue(reader, spec.type, decodeProtoMessage);
+    }
+  }
+
+  applyJsonDefaults(typeName, result);
+  return result;
+}
+
+export function decodeParseResult(buffer: Uint8Array): ParseResult {
+  if (!(buffer instanceof Uint8Array)) {
+    throw new TypeError(`Expected a Uint8Array, got ${typeof buffer}`);
+  }
+  const reader = new ProtobufReader(buffer);
+  return decodeProtoMessage(reader, buffer.length, 'ParseResult');
+}
+
+// Lazy decoding: each message records where its fields sit in the buffer and
+// decodes a field the first time it is read, replacing the accessor with the value
+
+function decodeLazyProtoMessage(reader: ProtobufReader, end: number, typeName: string): any {
+  const result = lazyProtoMessage(reader.buf, reader.pos, end, typeName);
+  reader.pos = end;
+  return result;
+}
+
+function decodeLazyField(buf: Uint8Array, spec: ProtoFieldSpec, offsets: number[]): any {
+  const reader = new ProtobufReader(buf);
+
+  if (!spec.repeated) {
+    // Last occurrence wins, as in the eager decoder
+    reader.pos = offsets[offsets.length - 2];
+    return decodeProtoValue(reader, spec.type, decodeLazyProtoMessage);
+  }
+
+  const values: any[] = [];
+  for (let i = 0; i < offsets.length; i += 2) {
+    reader.pos = offsets[i];
+    decodeProtoRepeated(reader, offsets[i + 1], spec, values, decodeLazyProtoMessage);
+  }
+  return values;
+}
+
+function lazyProtoMessage(buf: Uint8Array, start: number, end: number, typeName: string): any {
+  const specs = getProtoFieldSpecs(typeName);
+  const reader = new ProtobufReader(buf, start);
+
+  // [value position, wire type] pairs per field, in wire order
+  const fieldOffsets = new Map<ProtoFieldSpec, number[]>();
+  while (reader.pos < end) {
+    const tag = reader.uint32();
+    const spec = specs[tag >>> 3];
+    const wireType = tag & 7;
+
+    if (spec) {
+      let offsets = fieldOffsets.get(spec);
+      if (!offsets) {
+        fieldOffsets.set(spec, offsets = []);
+      }
+      offsets.push(reader.pos, wireType);
+    }
+    reader.skip(wireType);
+  }
+
+  const result: any = {};
+  fieldOffsets.forEach((offsets, spec) => {
+    const key = spec.key;
+    Object.defineProperty(result, key, {
+      enumerable: true,
+      configurable: true,
+      get() {
+        const value = decodeLazyField(buf, spec, offsets);
+        Object.defineProperty(this, key, { value, writable: true, enumerable: true, configurable: true });
+        return value;
+      },
+      set(value: any) {
+        Object.defineProperty(this, key, { value, writable: true, enumerable: true, configurable: true });
+      }
+    });
+  });
+
+  applyJsonDefaults(typeName, result);
+  return result;
+}
+
+export function decodeParseResultLazy(buffer: Uint8Array): ParseResult {
+  if (!(buffer instanceof Uint8Array)) {
+    throw new TypeError(`Expected a Uint8Array, got ${typeof buffer}`);
+  }
+  return lazyProtoMessage(buffer, 0, buffer.length, 'ParseResult');
+}
+
+export const parseLazy = awaitInit(async (query: string): Promise<ParseResult> => {
+  return parseLazySync(query);
+});
+
+export function parseLazySync(query: string): ParseResult {
+  return decodeParseResultLazy(parseProtobufSync(query));
+}
+
+// Protobuf encoding: the inverse of decodeProtoMessage, used by deparse. A first
+// pass measures the tree so the second can write straight into a buffer of the
+// exact size (on the WASM heap for deparse) with no intermediate message objects.
+
+const utf8Encoder = new TextEncoder();
+const float64Scratch = new Float64Array(1);
+const float64ScratchBytes = new Uint8Array(float64Scratch.buffer);
+
+function varint32Size(value: number): number {
+  value >>>= 0;
+  return value < 0x80 ? 1 : value < 0x4000 ? 2 : value < 0x200000 ? 3 : value < 0x10000000 ? 4 : 5;
+}
+
+function varint64Size(value: number): number {
+  if (value < 0) {
+    return 10;
+  }
+  if (value < 0x100000000) {
+    return varint32Size(value);
+  }
+  let size = 5;
+  for (value = Math.floor(value / 0x800000000); value > 0; value = Math.floor(value / 0x80)) {
+    size++;
+  }
+  return size;
+}
+
+function utf8Length(str: string): number {
+  let len = str.length;
+  for (let i = 0; i < str.length; i++) {
+    const c = str.charCodeAt(i);
+    if (c < 0x80) {
+      continue;
+    }
+    if (c < 0x800) {
+      len += 1;
+    } else if (c >= 0xd800 && c < 0xdc00 && i + 1 < str.length && (str.charCodeAt(i + 1) & 0xfc00) === 0xdc00) {
+      len += 2;
+      i++;
+    } else {
+      len += 2;
+    }
+  }
+  return len;
+}
+
+// Same coercions as protobufjs fromObject; enums accept names or numbers
+function toProtoScalar(type: string, value: any): any {
+  switch (type) {
+    case 'string': return String(value);
+    case 'bool': return Boolean(value);
+    case 'int32': return value | 0;
+    case 'uint32': return value >>> 0;
+    case 'int64':
+    case 'uint64':
+    case 'double': return Number(value);
+  }
+  if (typeof value === 'number') {
+    return value | 0;
+  }
+  return getProtoEnumValues(type)[value] ?? 0;
+}
+
+function protoWireType(type: string): number {
+  switch (type) {
+    case 'string': return 2;
+    case 'double': return 1;
+  }
+  return protoMessages[type] ? 2 : 0;
+}
+
+class ProtobufWriter {
+  // Lengths of nested messages, strings and packed fields, recorded by measure()
+  // in visit order and consumed in the same order by write()
+  private lengths: number[] = [];
+  private cursor = 0;
+  private buf!: Uint8Array;
+  private pos = 0;
+
+  measure(obj: any, typeName: string): number {
+    if (!obj || typeof obj !== 'object') {
+      throw new TypeError(`.${typeName}: object expected`);
+    }
+    const specs = getProtoKeySpecs(typeName);
+    let size = 0;
+
+    for (const key of Object.keys(obj)) {
+      const spec = specs.get(key);
+      const value = spec && obj[key];
+      if (!spec || value == null) {
+        continue;
+      }
+
+      const tagSize = varint32Size(spec.number << 3);
+      if (!spec.repeated) {
+        size += this.measureValue(spec.type, value, tagSize, false);
+        continue;
+      }
+
+      if (!Array.isArray(value)) {
+        throw new TypeError(`${typeName}.${key}: array expected`);
+      }
+      if (PROTO_VARINT_TYPES.has(spec.type)) {
+        if (value.length) {
+          let packed = 0;
+          for (const item of value) {
+            packed += this.scalarSize(spec.type, toProtoScalar(spec.type, item));
+          }
+          this.lengths.push(packed);
+          size += tagSize + varint32Size(packed) + packed;
+        }
+      } else {
+        for (const item of value) {
+          size += this.measureValue(spec.type, item, tagSize, true);
+        }
+      }
+    }
+
+    return size;
+  }
+
+  // Writes a tree measured by the matching measure() call into `buf` at `offset`
+  write(obj: any, typeName: string, buf: Uint8Array, offset: number) {
+    this.buf = buf;
+    this.pos = offset;
+    this.cursor = 0;
+    this.writeMessage(obj, typeName);
+  }
+
+  private measureValue(type: string, value: any, tagSize: number, repeated: boolean): number {
+    if (protoMessages[type]) {
+      const index = this.lengths.length;
+      this.lengths.push(0);
+      const len = this.measure(value, type);
+      this.lengths[index] = len;
+      return tagSize + varint32Size(len) + len;
+    }
+
+    value = toProtoScalar(type, value);
+    if (!repeated && (value === 0 || value === false || value === '')) {
+      return 0;
+    }
+    if (type === 'string') {
+      const len = utf8Length(value);
+      this.lengths.push(len);
+      return tagSize + varint32Size(len) + len;
+    }
+    return tagSize + this.scalarSize(type, value);
+  }
+
+  private scalarSize(type: string, value: any): number {
+    switch (type) {
+      case 'bool': return 1;
+      case 'double': return 8;
+      case 'uint32': return varint32Size(value);
+      case 'int64':
+      case 'uint64': return varint64Size(value);
+    }
+    // int32 and enums: negative values are sign-extended to ten bytes
+    return value < 0 ? 10 : varint32Size(value);
+  }
+
+  private writeMessage(obj: any, typeName: string) {
+    const specs = getProtoKeySpecs(typeName);
+
+    for (const key of Object.keys(obj)) {
+      const spec = specs.get(key);
+      const value = spec && obj[key];
+      if (!spec || value == null) {
+        continue;
+      }
+
+      const tag = spec.number << 3;
+      if (!spec.repeated) {
+        this.writeValue(spec.type, value, tag, false);
+      } else if (PROTO_VARINT_TYPES.has(spec.type)) {
+        if (value.length) {
+          this.writeVarint32(tag | 2);
+          this.writeVarint32(this.lengths[this.cursor++]);
+          for (const item of value) {
+            this.writeScalar(spec.type, toProtoScalar(spec.type, item));
+          }
+        }
+      } else {
+        for (const item of value) {
+          this.writeValue(spec.type, item, tag, true);
+        }
+      }
+    }
+  }
+
+  private writeValue(type: string, value: any, tag: number, repeated: boolean) {
+    if (protoMessages[type]) {
+      this.writeVarint32(tag | 2);
+      this.writeVarint32(this.lengths[this.cursor++]);
+      this.writeMessage(value, type);
+      return;
+    }
+
+    value = toProtoScalar(type, value);
+    if (!repeated && (value === 0 || value === false || value === '')) {
+      return;
+    }
+    this.writeVarint32(tag | protoWireType(type));
+    if (type === 'string') {
+      this.writeString(value, this.lengths[this.cursor++]);
+    } else {
+      this.writeScalar(type, value);
+    }
+  }
+
+  private writeScalar(type: string, value: any) {
+    switch (type) {
+      case 'bool':
+        this.buf[this.pos++] = value ? 1 : 0;
+        return;
+      case 'double':
+        float64Scratch[0] = value;
+        this.buf.set(float64ScratchBytes, this.pos);
+        this.pos += 8;
+        return;
+      case 'uint32':
+        this.writeVarint32(value);
+        return;
+    }
+    if (value >= 0 && value < 0x100000000) {
+      this.writeVarint32(value);
+    } else {
+      this.writeVarint64(value);
+    }
+  }
+
+  private writeString(str: string, len: number) {
+    this.writeVarint32(len);
+    if (len === str.length) {
+      for (let i = 0; i < len; i++) {
+        this.buf[this.pos++] = str.charCodeAt(i);
+      }
+    } else {
+      utf8Encoder.encodeInto(str, this.buf.subarray(this.pos, this.pos + len));
+      this.pos += len;
+    }
+  }
+
+  private writeVarint32(value: number) {
+    value >>>= 0;
+    while (value > 0x7f) {
+      this.buf[this.pos++] = (value & 0x7f) | 0x80;
+      value >>>= 7;
+    }
+    this.buf[this.pos++] = value;
+  }
+
+  private writeVarint64(value: number) {
+    const magnitude = Math.abs(value);
+    let lo = magnitude >>> 0;
+    let hi = Math.floor(magnitude / 0x100000000) >>> 0;
+    if (value < 0) {
+      // Two's complement across both halves
+      lo = (~lo + 1) >>> 0;
+      hi = (~hi + (lo === 0 ? 1 : 0)) >>> 0;
+    }
+    while (hi > 0 || lo > 0x7f) {
+      this.buf[this.pos++] = (lo & 0x7f) | 0x80;
+      lo = ((lo >>> 7) | (hi << 25)) >>> 0;
+      hi >>>= 7;
+    }
+    this.buf[this.pos++] = lo;
+  }
+}
+
+export function encodeParseResult(parseTree: ParseResult): Uint8Array {
+  const writer = new ProtobufWriter();
+  const buffer = new Uint8Array(writer.measure(parseTree, 'ParseResult'));
+  writer.write(parseTree, 'ParseResult', buffer, 0);
+  return buffer;
+}
+
+// Worker pool: spreads calls across worker threads, each with its own module instance
+
+export type ParserPoolMethod = 'parse' | 'deparse' | 'fingerprint' | 'normalize' | 'scan' | 'parsePlPgSQL';
+
+export interface ParserPoolOptions {
+  size?: number;   // Number of worker threads (default: available parallelism)
+  entry?: string;  // Module loaded by each worker (default: this module)
+}
+
+// Only calls that run on a worker can be interrupted, so the async API sends
+// every call that passes `signal` or `timeout` to its background pool, however
+// short the input, and rejects it where there is none (see configureAsync).
+export interface CallOptions {
+  signal?: AbortSignal;  // Rejects the call and stops the worker running it when aborted
+  timeout?: number;      // Milliseconds before the call is rejected with a TimeoutError
+}
+
+export interface AsyncOptions {
+  workers?: number;            // Worker threads behind parse(), deparse(), ... (default: available parallelism - 1 in Node.js); 0 keeps calls on the calling thread
+  inlineBelowLength?: number;  // Queries shorter than this many characters skip the worker (default: 1024)
+}
+
+interface PoolRequest {
+  id: number;
+  method: ParserPoolMethod;
+  args: any[];  // String inputs arrive as transferred UTF-8 bytes, parse trees as protobuf
+}
+
+interface PoolResponse {
+  id: number;
+  value?: any;
+  buffer?: Uint8Array;  // UTF-8 JSON parse tree, transferred rather than cloned
+  size?: number;        // Length of the serialized result, for the query cache
+  error?: { name: string; message: string; sqlDetails?: SqlErrorDetails };
+}
+
+interface PoolTask {
+  method: ParserPoolMethod;
+  args: any[];
+  resolve: (value: any, size?: number) => void;
+  reject: (error: Error) => void;
+  cancelled?: boolean;  // Still queued on the worker, whose reply is ignored
+}
+
+interface PoolWorker {
+  worker: Worker;
+  pending: Map<number, PoolTask>;
+}
+
+const POOL_WORKER_FLAG = 'pgQueryPoolWorker';
+
+const POOL_METHODS: Record<Exclude<ParserPoolMethod, 'parse'>, (input: any) => [any, number]> = {
+  deparse: (data: Uint8Array) => [deparseProtobuf(data), 0],
+  fingerprint: fingerprintUncached,
+  normalize: normalizeUncached,
+  scan: scanUncached,
+  parsePlPgSQL: (query) => [parsePlPgSQLSync(query), 0]
+};
+
+// Results of these methods share the query cache with their sync versions
+const POOL_CACHE_KINDS: Partial<Record<ParserPoolMethod, string>> = {
+  parse: 'p:',
+  fingerprint: 'f:',
+  normalize: 'n:',
+  scan: 's:'
+};
+
+// Node-only modules are required lazily so browser bundles never pull them in
+function nodeRequire(id: string): any {
+  if (typeof require === 'function') {
+    return require(id);
+  }
+  if (esmRequire) {
+    return esmRequire(id);
+  }
+  throw new Error(`${id} is only available in Node.js`);
+}
+
+// require() for the ES module build running in Node.js, set up by init() so
+// that the native addon, ParserPool and the background pool work there too
+let esmRequire: ((id: string) => any) | null = null;
+
+async function loadEsmRequire(): Promise<void> {
+  if (typeof require === 'function' || esmRequire || !ESM_MODULE_URL) {
+    return;
+  }
+  if (typeof process === 'undefined' || !process.versions?.node) {
+    return;
+  }
+  const { createRequire } = await import(/* webpackIgnore: true */ 'module');
+  esmRequire = createRequire(ESM_MODULE_URL);
+}
+
+function toPoolError(error: PoolResponse['error']): Error {
+  if (error.name === 'SqlError') {
+    return new SqlError(error.message, error.sqlDetails);
+  }
+  const result = new Error(error.message);
+  result.name = error.name;
+  return result;
+}
+
+function abortError(signal: AbortSignal): Error {
+  if (signal.reason instanceof Error) {
+    return signal.reason;
+  }
+  const error = new Error('The operation was aborted');
+  error.name = 'AbortError';
+  return error;
+}
+
+export class ParserPool {
+  readonly size: number;
+  private workers: PoolWorker[] = [];
+  private nextTaskId = 1;
+  private destroyed = false;
+  private readonly entry: string;
+  private readonly decoder = new TextDecoder();
+
+  constructor(options: ParserPoolOptions = {}) {
+    const os = nodeRequire('os');
+    const entry = options.entry || (typeof __filename !== 'undefined' ? __filename : undefined) ||
+      // The ES module build runs its workers on the CommonJS build next to it
+      (ESM_MODULE_URL ? nodeRequire('url').fileURLToPath(new URL('index.cjs', ESM_MODULE_URL)) : undefined);
+    if (!entry) {
+      throw new Error('ParserPool could not locate its worker module. Pass `entry` explicitly.');
+    }
+
+    this.entry = entry;
+    this.size = Math.max(1, options.size || (os.availableParallelism ? os.availableParallelism() : os.cpus().length));
+    for (let i = 0; i < this.size; i++) {
+      this.workers.push(this.spawn());
+    }
+  }
+
+  parse(query: string, options?: CallOptions): Promise<ParseResult> {
+    return this.run('parse', [query], options);
+  }
+
+  deparse(parseTree: ParseResult, options?: CallOptions): Promise<string> {
+    return this.run('deparse', [parseTree], options);
+  }
+
+  fingerprint(query: string, options?: CallOptions): Promise<string> {
+    return this.run('fingerprint', [query], options);
+  }
+
+  normalize(query: string, options?: CallOptions): Promise<string> {
+    return this.run('normalize', [query], options);
+  }
+
+  scan(query: string, options?: CallOptions): Promise<ScanResult> {
+    return this.run('scan', [query], options);
+  }
+
+  parsePlPgSQL(query: string, options?: CallOptions): Promise<ParseResult> {
+    return this.run('parsePlPgSQL', [query], options);
+  }
+
+  async destroy(): Promise<void> {
+    this.destroyed = true;
+    const workers = this.workers;
+    this.workers = [];
+    await Promise.all(workers.map(({ worker, pending }) => {
+      pending.forEach((task) => task.reject(new Error('ParserPool has been destroyed')));
+      pending.clear();
+      return worker.terminate();
+    }));
+  }
+
+  private run(method: ParserPoolMethod, args: any[], options: CallOptions = {}): Promise<any> {
+    if (this.destroyed) {
+      return Promise.reject(new Error('ParserPool has been destroyed'));
+    }
+    const { signal, timeout } = options;
+    if (signal?.aborted) {
+      return Promise.reject(abortError(signal));
+    }
+    if (method === 'deparse') {
+      try {
+        checkParseTree(args[0]);
+      } catch (error) {
+        return Promise.reject(error);
+      }
+    }
+
+    const cache = queryCache;
+    const kind = POOL_CACHE_KINDS[method];
+    const key = cache && kind && typeof args[0] === 'string' ? kind + args[0] : null;
+    if (cache && key) {
+      const hit = cache.get(key);
+      if (hit !== undefined) {
+        return Promise.resolve(hit);
+      }
+    }
+
+    // Least-loaded dispatch: the worker with the fewest outstanding tasks wins
+    let target = this.workers[0];
+    for (const slot of this.workers) {
+      if (slot.pending.size < target.pending.size) {
+        target = slot;
+      }
+    }
+
+    const id = this.nextTaskId++;
+    const collector = stats;
+    const started = collector ? performance.now() : 0;
+    return new Promise((resolve, reject) => {
+      let timer: ReturnType<typeof setTimeout> | undefined;
+      const onAbort = () => this.cancel(id, abortError(signal!));
+      const settle = (error: boolean) => {
+        clearTimeout(timer);
+        signal?.removeEventListener('abort', onAbort);
+        // Worker calls are timed end to end, queueing and transfer included
+        collector?.record({
+          operation: method,
+          background: true,
+          error,
+          totalMs: performance.now() - started,
+          marshalMs: 0,
+          wasmMs: 0,
+          decodeMs: 0,
+          bytesIn: 0,
+          bytesOut: 0,
+          heapGrowthBytes: 0
+        });
+      };
+
+      this.post(target, id, {
+        method,
+        args,
+        resolve: (value, size) => {
+          settle(false);
+          if (cache && key && size !== undefined) {
+            cache.set(key, value, (key.length + size) * 2);
+          }
+          resolve(value);
+        },
+        reject: (error) => {
+          settle(true);
+          reject(error);
+        }
+      });
+
+      signal?.addEventListener('abort', onAbort, { once: true });
+      if (timeout !== undefined) {
+        timer = setTimeout(() => {
+          const error = new Error(`${method} timed out after ${timeout}ms`);
+          error.name = 'TimeoutError';
+          this.cancel(id, error);
+        }, timeout);
+      }
+    });
+  }
+
+  private post(slot: PoolWorker, id: number, task: PoolTask) {
+    slot.pending.set(id, task);
+    if (slot.pending.size === 1) {
+      slot.worker.ref();
+    }
+    // Strings go over as UTF-8 bytes and parse trees as protobuf, encoded on
+    // every post so the buffer can be transferred rather than cloned
+    const input = typeof task.args[0] === 'string' ? utf8Encoder.encode(task.args[0])
+      : task.method === 'deparse' ? encodeParseResult(task.args[0]) : task.args[0];
+    const request: PoolRequest = { id, method: task.method, args: [input, ...task.args.slice(1)] };
+    slot.worker.postMessage(request, input instanceof Uint8Array ? [input.buffer as ArrayBuffer] : []);
+  }
+
+  // A worker runs its tasks in the order they were posted, so the first one
+  // in `pending` is the one running. A WASM call cannot be interrupted, so
+  // cancelling it replaces the worker and sends the rest of its queue to the
+  // replacement. A task still queued stays in `pending`, marked cancelled, so
+  // its reply is ignored and the order is kept.
+  private cancel(id: number, error: Error) {
+    const index = this.workers.findIndex((slot) => slot.pending.has(id));
+    if (index === -1) {
+      return;
+    }
+    const slot = this.workers[index];
+    const task = slot.pending.get(id)!;
+    if (task.cancelled) {
+      return;
+    }
+
+    if (slot.pending.keys().next().value !== id) {
+      slot.pending.set(id, { method: task.method, args: task.args, resolve: () => {}, reject: () => {}, cancelled: true });
+      task.reject(error);
+      return;
+    }
+
+    slot.pending.delete(id);
+    const replacement = this.spawn();
+    this.workers[index] = replacement;
+    slot.pending.forEach((queued, queuedId) => {
+      if (!queued.cancelled) {
+        this.post(replacement, queuedId, queued);
+      }
+    });
+    slot.pending.clear();
+    slot.worker.terminate();
+
+    task.reject(error);
+  }
+
+  private spawn(): PoolWorker {
+    const { Worker } = nodeRequire('worker_threads');
+    // Workers reuse the compiled module, and the backend, when this thread has
+    // already loaded them
+    const worker: Worker = new Worker(this.entry, {
+      workerData: { [POOL_WORKER_FLAG]: true, wasmModule: compiledWasm, backend: wasmModule ? getBackend() : undefined }
+    });
+    const slot: PoolWorker = { worker, pending: new Map() };
+
+    // Idle workers must not keep the process alive
+    worker.unref();
+
+    worker.on('message', (response: PoolResponse) => {
+      const task = slot.pending.get(response.id);
+      if (!task) return;
+
+      slot.pending.delete(response.id);
+      if (slot.pending.size === 0) {
+        worker.unref();
+      }
+
+      if (task.cancelled) {
+        return;
+      }
+      if (response.error) {
+        task.reject(toPoolError(response.error));
+      } else if (response.buffer) {
+        try {
+          task.resolve(JSON.parse(this.decoder.decode(response.buffer)), response.buffer.length);
+        } catch (error: any) {
+          task.reject(error);
+        }
+      } else {
+        task.resolve(response.value, response.size);
+      }
+    });
+
+    // A crashed worker fails its own tasks and is replaced in place
+    worker.on('error', (error: Error) => {
+      slot.pending.forEach((task) => task.reject(error));
+      slot.pending.clear();
+    });
+    worker.on('exit', () => {
+      const index = this.workers.indexOf(slot);
+      if (index !== -1 && !this.destroyed) {
+        slot.pending.forEach((task) => task.reject(new Error('ParserPool worker exited unexpectedly')));
+        this.workers[index] = this.spawn();
+      }
+    });
+
+    return slot;
+  }
+}
+
+function servePoolTasks(port: MessagePort, wasmModule: WebAssembly.Module | null, backend: Backend | undefined) {
+  port.on('message', async ({ id, method, args }: PoolRequest) => {
+    let response: PoolResponse;
+    try {
+      await loadModule({ wasmModule, backend });
+      const input = args[0] instanceof Uint8Array && method !== 'deparse' ? utf8Decoder.decode(args[0]) : args[0];
+      if (method === 'parse') {
+        const buffer = nativeAddon ? utf8Encoder.encode(parseNative(input)) : parseWith(input, ptrToBytes);
+        port.postMessage({ id, buffer } as PoolResponse, [buffer.buffer as ArrayBuffer]);
+        return;
+      }
+      const [value, size] = POOL_METHODS[method](input);
+      response = { id, value, size };
+    } catch (error: any) {
+      response = { id, error: { name: error.name, message: error.message, sqlDetails: error.sqlDetails } };
+    }
+    port.postMessage(response);
+  });
+}
+
+// In Node.js the async API (parse(), deparse(), ...) runs on a pool of its own,
+// started on first use and sized by configureAsync({ workers }). It stays on
+// the calling thread with workers: 0, where workers are unavailable, such as
+// in browsers, and for inputs short enough that a round trip to a worker would
+// cost more than the call itself.
+let asyncOptions: AsyncOptions & { inlineBelowLength: number } = { inlineBelowLength: 1024 };
+let asyncPool: ParserPool | null = null;
+
+// One worker per core but the calling thread's, where there are workers at all
+function defaultAsyncWorkers(): number {
+  try {
+    const os = nodeRequire('os');
+    return Math.max(1, (os.availableParallelism ? os.availableParallelism() : os.cpus().length) - 1);
+  } catch {
+    return 0;
+  }
+}
+
+export async function configureAsync(options: AsyncOptions): Promise<void> {
+  asyncOptions = { ...asyncOptions, ...options };
+  const pool = asyncPool;
+  asyncPool = null;
+  if (pool) {
+    await pool.destroy();
+  }
+}
+
+function runInBackground<T>(
+  method: ParserPoolMethod,
+  input: any,
+  options: CallOptions | undefined,
+  inline: () => T
+): T | Promise<T> {
+  // Resolved on first use, once the ES module build can require Node.js modules
+  asyncOptions.workers ??= defaultAsyncWorkers();
+  const interruptible = options?.signal !== undefined || options?.timeout !== undefined;
+  const inlined = asyncOptions.workers === 0 || (!interruptible && (typeof input === 'string'
+    ? input.length < asyncOptions.inlineBelowLength
+    : method !== 'deparse' || input === null || typeof input !== 'object'));
+  if (!inlined && !asyncPool) {
+    try {
+      asyncPool = new ParserPool({ size: asyncOptions.workers });
+    } catch {
+      asyncOptions.workers = 0;
+    }
+  }
+  if (inlined || !asyncPool) {
+    if (interruptible) {
+      throw new Error(`${method}: signal and timeout need a worker thread, and the async API has none (workers: 0 or no worker_threads)`);
+    }
+    return inline();
+  }
+  return (asyncPool as any)[method](input, options);
+}
+
+// When this module is loaded as a ParserPool worker, serve tasks from the parent thread
+if (typeof require === 'function') {
+  try {
+    const { isMainThread, parentPort, workerData } = nodeRequire('worker_threads');
+    if (!isMainThread && workerData && workerData[POOL_WORKER_FLAG]) {
+      servePoolTasks(parentPort, workerData.wasmModule, workerData.backend);
+    }
+  } catch {
+    // worker_threads is unavailable (e.g. bundled for the browser)
+  }
+}
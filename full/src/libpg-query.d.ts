@@ -14,6 +14,13 @@ declare module './libpg-query.js' {
     HEAPU8: Uint8Array;
   }
 
-  const PgQueryModule: () => Promise<WasmModule>;
+  interface ModuleOptions {
+    instantiateWasm?: (
+      imports: WebAssembly.Imports,
+      receiveInstance: (instance: WebAssembly.Instance, module: WebAssembly.Module) => void
+    ) => {};
+  }
+
+  const PgQueryModule: (options?: ModuleOptions) => Promise<WasmModule>;
   export default PgQueryModule;
 } 
\ No newline at end of file
@@ -0,0 +1,586 @@
+#include "wasm_wrapper.h"
+#include <node_api.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Native Node-API build of the wrapper: the same wasm_* entry points, linked
+// against a native libpg_query.a and called directly instead of through the
+// WASM heap. Each export takes and returns plain JS values that mirror what
+// index.ts reads out of the heap on the WASM path, so the two stay in step.
+// Inputs are copied into NUL-terminated buffers, as libpg_query expects.
+
+#define NAPI_CALL(env, call) do { \
+    if ((call) != napi_ok) { \
+        throw_last_error(env); \
+        return NULL; \
+    } \
+} while (0)
+
+#define MAX_ARGS 2
+
+static void throw_last_error(napi_env env) {
+    const napi_extended_error_info* info = NULL;
+    bool pending = false;
+    napi_is_exception_pending(env, &pending);
+    if (!pending) {
+        napi_get_last_error_info(env, &info);
+        napi_throw_error(env, NULL, info && info->error_message ? info->error_message : "Node-API call failed");
+    }
+}
+
+static void throw_message(napi_env env, const char* message) {
+    napi_throw_error(env, NULL, message ? message : "Memory allocation failed");
+}
+
+static napi_value make_string(napi_env env, const char* str) {
+    napi_value value;
+    if (!str || napi_create_string_utf8(env, str, NAPI_AUTO_LENGTH, &value) != napi_ok) {
+        napi_get_null(env, &value);
+    }
+    return value;
+}
+
+static napi_value make_int(napi_env env, int32_t number) {
+    napi_value value;
+    napi_create_int32(env, number, &value);
+    return value;
+}
+
+static void set_named(napi_env env, napi_value object, const char* name, napi_value value) {
+    napi_set_named_property(env, object, name, value);
+}
+
+// An Error carrying the PgQueryError fields; index.ts turns it into a SqlError
+static napi_value make_pg_error(napi_env env, const PgQueryError* error) {
+    napi_value result;
+    napi_create_error(env, NULL, make_string(env, error->message ? error->message : "Unknown error"), &result);
+    set_named(env, result, "cursorpos", make_int(env, error->cursorpos));
+    set_named(env, result, "lineno", make_int(env, error->lineno));
+    if (error->funcname) {
+        set_named(env, result, "funcname", make_string(env, error->funcname));
+    }
+    if (error->filename) {
+        set_named(env, result, "filename", make_string(env, error->filename));
+    }
+    return result;
+}
+
+// Reads the arguments and copies the first one, a string or a Uint8Array, into
+// a NUL-terminated buffer the caller frees. Returns NULL with an exception set.
+static char* get_input(napi_env env, napi_callback_info info, napi_value* args, size_t* length) {
+    size_t argc = MAX_ARGS;
+    napi_valuetype type;
+    bool is_typedarray = false;
+
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 1) {
+        napi_throw_type_error(env, NULL, "Expected an input argument");
+        return NULL;
+    }
+
+    napi_typeof(env, args[0], &type);
+    if (type == napi_string) {
+        size_t len;
+        napi_get_value_string_utf8(env, args[0], NULL, 0, &len);
+        char* input = (char*)malloc(len + 1);
+        if (!input) {
+            throw_message(env, NULL);
+            return NULL;
+        }
+        napi_get_value_string_utf8(env, args[0], input, len + 1, &len);
+        *length = len;
+        return input;
+    }
+
+    napi_is_typedarray(env, args[0], &is_typedarray);
+    if (is_typedarray) {
+        napi_typedarray_type array_type;
+        size_t len;
+        void* data;
+        napi_get_typedarray_info(env, args[0], &array_type, &len, &data, NULL, NULL);
+        if (array_type == napi_uint8_array) {
+            char* input = (char*)malloc(len + 1);
+            if (!input) {
+                throw_message(env, NULL);
+                return NULL;
+            }
+            memcpy(input, data, len);
+            input[len] = '\0';
+            *length = len;
+            return input;
+        }
+    }
+
+    napi_throw_type_error(env, NULL, "Expected a string or Uint8Array");
+    return NULL;
+}
+
+static int32_t get_int_arg(napi_env env, napi_value* args, size_t index) {
+    int32_t value = 0;
+    napi_get_value_int32(env, args[index], &value);
+    return value;
+}
+
+// Copies `bytes` bytes into a new ArrayBuffer, which is always suitably
+// aligned for the Int32Array views index.ts puts on it
+static napi_value make_array_buffer(napi_env env, const void* data, size_t bytes) {
+    napi_value buffer;
+    void* out;
+    if (napi_create_arraybuffer(env, bytes, &out, &buffer) != napi_ok) {
+        return NULL;
+    }
+    if (bytes > 0) {
+        memcpy(out, data, bytes);
+    }
+    return buffer;
+}
+
+static napi_value make_int32_array(napi_env env, const int32_t* data, size_t count) {
+    napi_value buffer = make_array_buffer(env, data, count * sizeof(int32_t));
+    napi_value array;
+    if (!buffer || napi_create_typedarray(env, napi_int32_array, count, buffer, 0, &array) != napi_ok) {
+        return NULL;
+    }
+    return array;
+}
+
+// Calls that return one malloc'd string, with errors as message text in place
+// of the result, as on the WASM path
+static napi_value call_string(napi_env env, napi_callback_info info, char* (*call)(const char*)) {
+    napi_value args[MAX_ARGS];
+    size_t length;
+    char* input = get_input(env, info, args, &length);
+    if (!input) {
+        return NULL;
+    }
+    char* result = call(input);
+    free(input);
+    if (!result) {
+        throw_message(env, NULL);
+        return NULL;
+    }
+    napi_value value = make_string(env, result);
+    wasm_free_string(result);
+    return value;
+}
+
+static napi_value Parse(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    size_t length;
+    char* input = get_input(env, info, args, &length);
+    if (!input) {
+        return NULL;
+    }
+    PgQueryParseResult* result = wasm_parse_query_raw(input);
+    free(input);
+    if (!result) {
+        throw_message(env, NULL);
+        return NULL;
+    }
+
+    napi_value value = NULL;
+    if (result->error) {
+        napi_throw(env, make_pg_error(env, result->error));
+    } else if (!result->parse_tree) {
+        throw_message(env, "No parse tree generated");
+    } else {
+        value = make_string(env, result->parse_tree);
+    }
+    wasm_free_parse_result(result);
+    return value;
+}
+
+static napi_value ParseProtobuf(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    size_t length;
+    char* input = get_input(env, info, args, &length);
+    if (!input) {
+        return NULL;
+    }
+    PgQueryProtobufParseResult* result = wasm_parse_query_protobuf_raw(input);
+    free(input);
+    if (!result) {
+        throw_message(env, NULL);
+        return NULL;
+    }
+
+    napi_value value = NULL;
+    if (result->error) {
+        napi_throw(env, make_pg_error(env, result->error));
+    } else {
+        napi_value buffer = make_array_buffer(env, result->parse_tree.data, result->parse_tree.len);
+        if (!buffer || napi_create_typedarray(env, napi_uint8_array, result->parse_tree.len, buffer, 0, &value) != napi_ok) {
+            throw_message(env, NULL);
+            value = NULL;
+        }
+    }
+    wasm_free_protobuf_parse_result(result);
+    return value;
+}
+
+static napi_value Deparse(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    size_t length;
+    char* input = get_input(env, info, args, &length);
+    if (!input) {
+        return NULL;
+    }
+    char* result = wasm_deparse_protobuf(input, length);
+    free(input);
+    if (!result) {
+        throw_message(env, NULL);
+        return NULL;
+    }
+    napi_value value = make_string(env, result);
+    wasm_free_string(result);
+    return value;
+}
+
+static napi_value ParsePlpgsql(napi_env env, napi_callback_info info) {
+    return call_string(env, info, wasm_parse_plpgsql);
+}
+
+static napi_value Fingerprint(napi_env env, napi_callback_info info) {
+    return call_string(env, info, wasm_fingerprint);
+}
+
+static napi_value Normalize(napi_env env, napi_callback_info info) {
+    return call_string(env, info, wasm_normalize_query);
+}
+
+static napi_value Scan(napi_env env, napi_callback_info info) {
+    return call_string(env, info, wasm_scan);
+}
+
+// Calls that return one int32 block, or NULL with a malloc'd error message.
+// The block comes back as an Int32Array of `words(block)` words.
+static napi_value call_block(napi_env env, napi_value* args, char* input,
+                             int32_t* (*call)(const char*, char**), size_t (*words)(const int32_t*)) {
+    char* error = NULL;
+    int32_t* block = call(input, &error);
+    free(input);
+    if (!block) {
+        throw_message(env, error);
+        free(error);
+        return NULL;
+    }
+    napi_value value = make_int32_array(env, block, words(block));
+    free(block);
+    return value;
+}
+
+// [version, count, start[count], end[count], tokenType[count], keywordKind[count]]
+static size_t scan_words(const int32_t* block) {
+    return 2 + 4 * (size_t)block[1];
+}
+
+// [count, errorAt, location0, length0, ...]
+static size_t split_words(const int32_t* block) {
+    return 2 + 2 * (size_t)block[0];
+}
+
+static napi_value ScanBinary(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    size_t length;
+    char* input = get_input(env, info, args, &length);
+    if (!input) {
+        return NULL;
+    }
+    bool fast = false;
+    napi_get_value_bool(env, args[1], &fast);
+    return call_block(env, args, input, fast ? wasm_scan_fast : wasm_scan_binary, scan_words);
+}
+
+static napi_value SplitStatements(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    size_t length;
+    char* input = get_input(env, info, args, &length);
+    if (!input) {
+        return NULL;
+    }
+    return call_block(env, args, input, wasm_split_statements, split_words);
+}
+
+// Batch calls take the same NUL-packed input as on the WASM path and a count
+static char* get_batch(napi_env env, napi_callback_info info, napi_value* args, int32_t* count) {
+    size_t length;
+    char* inputs = get_input(env, info, args, &length);
+    if (inputs) {
+        *count = get_int_arg(env, args, 1);
+        if (*count <= 0) {
+            free(inputs);
+            napi_throw_range_error(env, NULL, "Expected a positive count");
+            return NULL;
+        }
+    }
+    return inputs;
+}
+
+// Each item is the parse tree JSON or an Error
+static napi_value ParseBatch(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    int32_t count;
+    char* inputs = get_batch(env, info, args, &count);
+    if (!inputs) {
+        return NULL;
+    }
+    PgQueryParseResult* results = wasm_parse_batch(inputs, count);
+    free(inputs);
+    if (!results) {
+        throw_message(env, NULL);
+        return NULL;
+    }
+
+    napi_value array;
+    napi_create_array_with_length(env, count, &array);
+    for (int32_t i = 0; i < count; i++) {
+        napi_value item;
+        if (results[i].error) {
+            item = make_pg_error(env, results[i].error);
+        } else {
+            item = make_string(env, results[i].parse_tree);
+        }
+        napi_set_element(env, array, i, item);
+    }
+    wasm_free_parse_batch(results, count);
+    return array;
+}
+
+// Each item is null when valid, or [message, cursorpos]
+static napi_value ValidateBatch(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    int32_t count;
+    char* inputs = get_batch(env, info, args, &count);
+    if (!inputs) {
+        return NULL;
+    }
+    WasmValidateResult* results = (WasmValidateResult*)calloc(count, sizeof(WasmValidateResult));
+    if (!results || wasm_validate_batch(inputs, count, results) < 0) {
+        free(inputs);
+        free(results);
+        throw_message(env, NULL);
+        return NULL;
+    }
+    free(inputs);
+
+    napi_value array;
+    napi_create_array_with_length(env, count, &array);
+    for (int32_t i = 0; i < count; i++) {
+        napi_value item;
+        if (results[i].valid) {
+            napi_get_null(env, &item);
+        } else {
+            napi_create_array_with_length(env, 2, &item);
+            napi_set_element(env, item, 0, make_string(env, results[i].message));
+            napi_set_element(env, item, 1, make_int(env, results[i].cursorpos));
+            wasm_free_string(results[i].message);
+        }
+        napi_set_element(env, array, i, item);
+    }
+    free(results);
+    return array;
+}
+
+// Returns a BigUint64Array with 0 for queries that fail
+static napi_value FingerprintBatch(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    int32_t count;
+    char* inputs = get_batch(env, info, args, &count);
+    if (!inputs) {
+        return NULL;
+    }
+
+    napi_value buffer;
+    napi_value array;
+    void* out;
+    if (napi_create_arraybuffer(env, count * sizeof(uint64_t), &out, &buffer) != napi_ok) {
+        free(inputs);
+        throw_message(env, NULL);
+        return NULL;
+    }
+    int status = wasm_fingerprint_batch(inputs, count, (uint64_t*)out);
+    free(inputs);
+    if (status < 0) {
+        throw_message(env, NULL);
+        return NULL;
+    }
+    NAPI_CALL(env, napi_create_typedarray(env, napi_biguint64_array, count, buffer, 0, &array));
+    return array;
+}
+
+// Each item is [normalizedQuery, Int32Array columns] or an error message, with
+// the columns laid out as [param[n], location[n], length[n], kind[n]]
+static napi_value NormalizeBatch(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    int32_t count;
+    char* inputs = get_batch(env, info, args, &count);
+    if (!inputs) {
+        return NULL;
+    }
+    WasmNormalizeResult* results = (WasmNormalizeResult*)calloc(count, sizeof(WasmNormalizeResult));
+    if (!results || wasm_normalize_batch(inputs, count, results) < 0) {
+        free(inputs);
+        free(results);
+        throw_message(env, NULL);
+        return NULL;
+    }
+    free(inputs);
+
+    napi_value array;
+    napi_create_array_with_length(env, count, &array);
+    for (int32_t i = 0; i < count; i++) {
+        napi_value item;
+        if (results[i].normalized_query) {
+            napi_create_array_with_length(env, 2, &item);
+            napi_set_element(env, item, 0, make_string(env, results[i].normalized_query));
+            napi_set_element(env, item, 1, make_int32_array(env, results[i].constants + 1, 4 * (size_t)results[i].constants[0]));
+        } else {
+            item = make_string(env, results[i].error);
+        }
+        napi_set_element(env, array, i, item);
+    }
+    wasm_free_normalize_batch(results, count);
+    return array;
+}
+
+// Returns { parseTree?, normalized?, fingerprint?, scan? } for the ANALYZE_*
+// flags, with scan as the wasm_scan_binary block
+static napi_value Analyze(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    size_t length;
+    char* input = get_input(env, info, args, &length);
+    if (!input) {
+        return NULL;
+    }
+    WasmAnalyzeResult* result = wasm_analyze(input, get_int_arg(env, args, 1));
+    free(input);
+    if (!result) {
+        throw_message(env, NULL);
+        return NULL;
+    }
+
+    napi_value value = NULL;
+    if (result->error) {
+        napi_throw(env, make_pg_error(env, result->error));
+    } else {
+        napi_create_object(env, &value);
+        if (result->parse_tree) {
+            set_named(env, value, "parseTree", make_string(env, result->parse_tree));
+        }
+        if (result->normalized_query) {
+            set_named(env, value, "normalized", make_string(env, result->normalized_query));
+        }
+        if (result->fingerprint_str) {
+            set_named(env, value, "fingerprint", make_string(env, result->fingerprint_str));
+        }
+        if (result->scan) {
+            set_named(env, value, "scan", make_int32_array(env, result->scan, scan_words(result->scan)));
+        }
+    }
+    wasm_free_analyze_result(result);
+    return value;
+}
+
+// Returns the references block from references.c as an ArrayBuffer
+static napi_value ExtractReferences(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    size_t length;
+    char* input = get_input(env, info, args, &length);
+    if (!input) {
+        return NULL;
+    }
+    WasmReferencesResult* result = wasm_extract_references(input);
+    free(input);
+    if (!result) {
+        throw_message(env, NULL);
+        return NULL;
+    }
+
+    napi_value value = NULL;
+    if (result->error) {
+        napi_throw(env, make_pg_error(env, result->error));
+    } else {
+        // Header word 4 is the size of the whole block
+        value = make_array_buffer(env, result->block, result->block[4]);
+    }
+    wasm_free_references_result(result);
+    return value;
+}
+
+// Each item is [location, length, plpgsqlFuncsJson | null, message | null, cursorpos]
+static napi_value ParsePlpgsqlDump(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    size_t length;
+    char* input = get_input(env, info, args, &length);
+    if (!input) {
+        return NULL;
+    }
+    char* error = NULL;
+    WasmPlpgsqlDumpResult* result = wasm_parse_plpgsql_dump(input, &error);
+    free(input);
+    if (!result) {
+        throw_message(env, error);
+        free(error);
+        return NULL;
+    }
+
+    napi_value array;
+    napi_create_array_with_length(env, result->count, &array);
+    for (int32_t i = 0; i < result->count; i++) {
+        const WasmPlpgsqlFunction* function = &result->functions[i];
+        napi_value item;
+        napi_create_array_with_length(env, 5, &item);
+        napi_set_element(env, item, 0, make_int(env, function->location));
+        napi_set_element(env, item, 1, make_int(env, function->length));
+        napi_set_element(env, item, 2, make_string(env, function->plpgsql_funcs));
+        napi_set_element(env, item, 3, make_string(env, function->error));
+        napi_set_element(env, item, 4, make_int(env, function->cursorpos));
+        napi_set_element(env, array, i, item);
+    }
+    wasm_free_plpgsql_dump(result);
+    return array;
+}
+
+static napi_value SetTiming(napi_env env, napi_callback_info info) {
+    napi_value args[MAX_ARGS];
+    size_t argc = MAX_ARGS;
+    bool enabled = false;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+    if (argc > 0) {
+        napi_get_value_bool(env, args[0], &enabled);
+    }
+    wasm_set_timing(enabled);
+    return NULL;
+}
+
+static napi_value TakeTiming(napi_env env, napi_callback_info info) {
+    napi_value value;
+    NAPI_CALL(env, napi_create_double(env, wasm_take_timing(), &value));
+    return value;
+}
+
+NAPI_MODULE_INIT() {
+    napi_property_descriptor properties[] = {
+        { "parse", NULL, Parse, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "parseProtobuf", NULL, ParseProtobuf, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "deparse", NULL, Deparse, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "parsePlPgSQL", NULL, ParsePlpgsql, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "fingerprint", NULL, Fingerprint, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "normalize", NULL, Normalize, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "scan", NULL, Scan, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "scanBinary", NULL, ScanBinary, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "splitStatements", NULL, SplitStatements, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "parseBatch", NULL, ParseBatch, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "validateBatch", NULL, ValidateBatch, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "fingerprintBatch", NULL, FingerprintBatch, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "normalizeBatch", NULL, NormalizeBatch, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "analyze", NULL, Analyze, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "extractReferences", NULL, ExtractReferences, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "parsePlPgSQLDump", NULL, ParsePlpgsqlDump, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "setTiming", NULL, SetTiming, NULL, NULL, NULL, napi_enumerable, NULL },
+        { "takeTiming", NULL, TakeTiming, NULL, NULL, NULL, napi_enumerable, NULL },
+    };
+    if (napi_define_properties(env, exports, sizeof(properties) / sizeof(properties[0]), properties) != napi_ok) {
+        return NULL;
+    }
+    return exports;
+}
@@ -1,20 +1,5 @@
-declare module '../proto.js' {
-  export namespace pg_query {
-    interface ParseResult {
-      version: number;
-      stmts: Statement[];
-    }
-
-    interface Statement {
-      stmt_type: string;
-      stmt_len: number;
-      stmt_location: number;
-      query: string;
-    }
-
-    class ParseResult {
-      static fromObject(obj: ParseResult): ParseResult;
-      static encode(msg: ParseResult): { finish(): Uint8Array };
-    }
-  }
-} 
\ No newline at end of file
+declare module '../proto-schema.js' {
+  // [field number, AST key, type name, repeated (0|1)]
+  export const messages: Record<string, [number, string, string, number][]>;
+  export const enums: Record<string, Record<string, string>>;
+}
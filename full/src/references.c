@@ -0,0 +1,565 @@
+#include "pg_query.h"
+#include "pg_query_internal.h"
+#include "wasm_wrapper.h"
+
+#include "lib/stringinfo.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/parsenodes.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Relation and function references, collected by walking the raw parse tree
+// inside WASM. The tree is never serialized: only the names, access kinds and
+// locations below are copied out, into one block that JS decodes in place.
+//
+// Block layout (int32 words, then the string table):
+//   [relationCount, functionCount, statementCount, stringsOffset, blockSize,
+//    relations:  relationCount  x [schema, name, alias, access, location, statement],
+//    functions:  functionCount  x [schema, name, location, statement],
+//    statements: statementCount x [type, location, length],
+//    NUL-terminated strings...]
+// Strings are byte offsets into the table starting at stringsOffset, or -1.
+// blockSize is the size of the whole block in bytes, string table included.
+
+#define REFERENCES_HEADER_WORDS 5
+
+// Access kinds; keep in sync with REFERENCE_ACCESS in index.ts
+#define ACCESS_SELECT   0
+#define ACCESS_INSERT   1
+#define ACCESS_UPDATE   2
+#define ACCESS_DELETE   3
+#define ACCESS_MERGE    4
+#define ACCESS_TRUNCATE 5
+#define ACCESS_CREATE   6
+#define ACCESS_ALTER    7
+#define ACCESS_DROP     8
+#define ACCESS_OTHER    9
+
+typedef struct {
+    StringInfoData relations;
+    StringInfoData functions;
+    StringInfoData statements;
+    StringInfoData strings;
+    List* ctes;           // Names of the CTEs in scope, innermost last
+    int32_t statement;    // Index of the statement being walked
+} ReferenceContext;
+
+static bool reference_walker(Node* node, ReferenceContext* ctx);
+static bool walk_statement(Node* node, ReferenceContext* ctx);
+
+static int32_t add_string(ReferenceContext* ctx, const char* str) {
+    if (!str) {
+        return -1;
+    }
+    int32_t offset = ctx->strings.len;
+    appendBinaryStringInfo(&ctx->strings, str, strlen(str) + 1);
+    return offset;
+}
+
+static bool is_cte_name(ReferenceContext* ctx, const char* name) {
+    ListCell* lc;
+    foreach(lc, ctx->ctes) {
+        if (strcmp((const char*)lfirst(lc), name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void add_relation(ReferenceContext* ctx, RangeVar* rv, int32_t access) {
+    // An unqualified name that matches a CTE in scope refers to the CTE
+    if (!rv || (!rv->schemaname && is_cte_name(ctx, rv->relname))) {
+        return;
+    }
+    int32_t record[6] = {
+        add_string(ctx, rv->schemaname),
+        add_string(ctx, rv->relname),
+        add_string(ctx, rv->alias ? rv->alias->aliasname : NULL),
+        access,
+        rv->location,
+        ctx->statement
+    };
+    appendBinaryStringInfo(&ctx->relations, (const char*)record, sizeof(record));
+}
+
+// DROP TABLE and friends name their objects as String lists, without a location
+static void add_relation_name(ReferenceContext* ctx, List* names, int32_t access) {
+    int length = list_length(names);
+    if (length == 0) {
+        return;
+    }
+    RangeVar rv = {0};
+    rv.relname = strVal(llast(names));
+    rv.schemaname = length > 1 ? strVal(list_nth(names, length - 2)) : NULL;
+    rv.location = -1;
+    add_relation(ctx, &rv, access);
+}
+
+static void add_function(ReferenceContext* ctx, List* funcname, int location) {
+    int length = list_length(funcname);
+    if (length == 0) {
+        return;
+    }
+    int32_t record[4] = {
+        add_string(ctx, length > 1 ? strVal(list_nth(funcname, length - 2)) : NULL),
+        add_string(ctx, strVal(llast(funcname))),
+        location,
+        ctx->statement
+    };
+    appendBinaryStringInfo(&ctx->functions, (const char*)record, sizeof(record));
+}
+
+// Walks the CTEs of a WITH clause, leaving their names in scope for the rest
+// of the statement. A non-recursive CTE only sees the CTEs before it, so a CTE
+// named after a table can still read that table.
+static bool walk_with(WithClause* with, ReferenceContext* ctx) {
+    ListCell* lc;
+    if (!with) {
+        return false;
+    }
+    if (with->recursive) {
+        foreach(lc, with->ctes) {
+            ctx->ctes = lappend(ctx->ctes, lfirst_node(CommonTableExpr, lc)->ctename);
+        }
+    }
+    foreach(lc, with->ctes) {
+        CommonTableExpr* cte = lfirst_node(CommonTableExpr, lc);
+        if (reference_walker(cte->ctequery, ctx)) {
+            return true;
+        }
+        if (!with->recursive) {
+            ctx->ctes = lappend(ctx->ctes, cte->ctename);
+        }
+    }
+    return false;
+}
+
+// Foreign keys read the referenced table
+static void add_constraint_refs(ReferenceContext* ctx, Node* node) {
+    if (!node) {
+        return;
+    }
+    if (IsA(node, Constraint)) {
+        add_relation(ctx, ((Constraint*)node)->pktable, ACCESS_OTHER);
+    } else if (IsA(node, ColumnDef)) {
+        ListCell* lc;
+        foreach(lc, ((ColumnDef*)node)->constraints) {
+            add_constraint_refs(ctx, lfirst(lc));
+        }
+    }
+}
+
+static bool is_relation_object(ObjectType type) {
+    return type == OBJECT_TABLE || type == OBJECT_VIEW || type == OBJECT_MATVIEW ||
+        type == OBJECT_FOREIGN_TABLE || type == OBJECT_SEQUENCE || type == OBJECT_INDEX;
+}
+
+// Utility statements are not covered by raw_expression_tree_walker, so the
+// ones that name relations are taken apart here. Sets *handled to false for
+// the rest, which contribute only their statement type.
+static bool walk_utility(Node* node, ReferenceContext* ctx, bool* handled) {
+    ListCell* lc;
+    *handled = true;
+    switch (nodeTag(node)) {
+        case T_CreateStmt: {
+            CreateStmt* stmt = (CreateStmt*)node;
+            add_relation(ctx, stmt->relation, ACCESS_CREATE);
+            foreach(lc, stmt->inhRelations) {
+                add_relation(ctx, lfirst_node(RangeVar, lc), ACCESS_OTHER);
+            }
+            foreach(lc, stmt->tableElts) {
+                add_constraint_refs(ctx, lfirst(lc));
+            }
+            foreach(lc, stmt->constraints) {
+                add_constraint_refs(ctx, lfirst(lc));
+            }
+            return false;
+        }
+        case T_CreateTableAsStmt: {
+            CreateTableAsStmt* stmt = (CreateTableAsStmt*)node;
+            add_relation(ctx, stmt->into->rel, ACCESS_CREATE);
+            return walk_statement(stmt->query, ctx);
+        }
+        case T_ViewStmt: {
+            ViewStmt* stmt = (ViewStmt*)node;
+            add_relation(ctx, stmt->view, ACCESS_CREATE);
+            return reference_walker(stmt->query, ctx);
+        }
+        case T_CreateSeqStmt:
+            add_relation(ctx, ((CreateSeqStmt*)node)->sequence, ACCESS_CREATE);
+            return false;
+        case T_AlterSeqStmt:
+            add_relation(ctx, ((AlterSeqStmt*)node)->sequence, ACCESS_ALTER);
+            return false;
+        case T_AlterTableStmt: {
+            AlterTableStmt* stmt = (AlterTableStmt*)node;
+            add_relation(ctx, stmt->relation, ACCESS_ALTER);
+            foreach(lc, stmt->cmds) {
+                add_constraint_refs(ctx, lfirst_node(AlterTableCmd, lc)->def);
+            }
+            return false;
+        }
+        case T_RenameStmt:
+            add_relation(ctx, ((RenameStmt*)node)->relation, ACCESS_ALTER);
+            return false;
+        case T_IndexStmt:
+            add_relation(ctx, ((IndexStmt*)node)->relation, ACCESS_ALTER);
+            return false;
+        case T_CreateTrigStmt: {
+            CreateTrigStmt* stmt = (CreateTrigStmt*)node;
+            add_relation(ctx, stmt->relation, ACCESS_ALTER);
+            add_function(ctx, stmt->funcname, -1);
+            return false;
+        }
+        case T_RuleStmt:
+            add_relation(ctx, ((RuleStmt*)node)->relation, ACCESS_ALTER);
+            return false;
+        case T_DropStmt: {
+            DropStmt* stmt = (DropStmt*)node;
+            if (is_relation_object(stmt->removeType)) {
+                foreach(lc, stmt->objects) {
+                    add_relation_name(ctx, lfirst_node(List, lc), ACCESS_DROP);
+                }
+            }
+            return false;
+        }
+        case T_TruncateStmt:
+            foreach(lc, ((TruncateStmt*)node)->relations) {
+                add_relation(ctx, lfirst_node(RangeVar, lc), ACCESS_TRUNCATE);
+            }
+            return false;
+        case T_CopyStmt: {
+            CopyStmt* stmt = (CopyStmt*)node;
+            add_relation(ctx, stmt->relation, stmt->is_from ? ACCESS_INSERT : ACCESS_SELECT);
+            return walk_statement(stmt->query, ctx) || reference_walker(stmt->whereClause, ctx);
+        }
+        case T_LockStmt:
+            foreach(lc, ((LockStmt*)node)->relations) {
+                add_relation(ctx, lfirst_node(RangeVar, lc), ACCESS_OTHER);
+            }
+            return false;
+        case T_VacuumStmt:
+            foreach(lc, ((VacuumStmt*)node)->rels) {
+                add_relation(ctx, lfirst_node(VacuumRelation, lc)->relation, ACCESS_OTHER);
+            }
+            return false;
+        case T_ClusterStmt:
+            add_relation(ctx, ((ClusterStmt*)node)->relation, ACCESS_OTHER);
+            return false;
+        case T_ReindexStmt:
+            add_relation(ctx, ((ReindexStmt*)node)->relation, ACCESS_OTHER);
+            return false;
+        case T_RefreshMatViewStmt:
+            add_relation(ctx, ((RefreshMatViewStmt*)node)->relation, ACCESS_OTHER);
+            return false;
+        case T_GrantStmt: {
+            GrantStmt* stmt = (GrantStmt*)node;
+            if (stmt->targtype == ACL_TARGET_OBJECT &&
+                (stmt->objtype == OBJECT_TABLE || stmt->objtype == OBJECT_SEQUENCE)) {
+                foreach(lc, stmt->objects) {
+                    add_relation(ctx, lfirst_node(RangeVar, lc), ACCESS_OTHER);
+                }
+            }
+            return false;
+        }
+        case T_CallStmt:
+            return reference_walker((Node*)((CallStmt*)node)->funccall, ctx);
+        case T_ExplainStmt:
+            return walk_statement(((ExplainStmt*)node)->query, ctx);
+        case T_DeclareCursorStmt:
+            return walk_statement(((DeclareCursorStmt*)node)->query, ctx);
+        case T_PrepareStmt:
+            return walk_statement(((PrepareStmt*)node)->query, ctx);
+        default:
+            *handled = false;
+            return false;
+    }
+}
+
+static bool reference_walker(Node* node, ReferenceContext* ctx) {
+    if (node == NULL) {
+        return false;
+    }
+
+    int scope = list_length(ctx->ctes);
+    bool result;
+
+    switch (nodeTag(node)) {
+        case T_RangeVar:
+            add_relation(ctx, (RangeVar*)node, ACCESS_SELECT);
+            return false;
+        case T_FuncCall:
+            add_function(ctx, ((FuncCall*)node)->funcname, ((FuncCall*)node)->location);
+            break;
+        case T_SelectStmt: {
+            // The tree is thrown away after the walk, so parts handled here are
+            // unhooked instead of being skipped in the generic walk
+            SelectStmt* stmt = (SelectStmt*)node;
+            if (walk_with(stmt->withClause, ctx)) {
+                return true;
+            }
+            if (stmt->intoClause) {
+                add_relation(ctx, stmt->intoClause->rel, ACCESS_CREATE);
+            }
+            stmt->withClause = NULL;
+            stmt->intoClause = NULL;
+            // FOR UPDATE OF names tables already listed in FROM, usually by alias
+            stmt->lockingClause = NIL;
+            break;
+        }
+        case T_InsertStmt: {
+            InsertStmt* stmt = (InsertStmt*)node;
+            if (walk_with(stmt->withClause, ctx)) {
+                return true;
+            }
+            add_relation(ctx, stmt->relation, ACCESS_INSERT);
+            stmt->withClause = NULL;
+            stmt->relation = NULL;
+            break;
+        }
+        case T_UpdateStmt: {
+            UpdateStmt* stmt = (UpdateStmt*)node;
+            if (walk_with(stmt->withClause, ctx)) {
+                return true;
+            }
+            add_relation(ctx, stmt->relation, ACCESS_UPDATE);
+            stmt->withClause = NULL;
+            stmt->relation = NULL;
+            break;
+        }
+        case T_DeleteStmt: {
+            DeleteStmt* stmt = (DeleteStmt*)node;
+            if (walk_with(stmt->withClause, ctx)) {
+                return true;
+            }
+            add_relation(ctx, stmt->relation, ACCESS_DELETE);
+            stmt->withClause = NULL;
+            stmt->relation = NULL;
+            break;
+        }
+        case T_MergeStmt: {
+            MergeStmt* stmt = (MergeStmt*)node;
+            if (walk_with(stmt->withClause, ctx)) {
+                return true;
+            }
+            add_relation(ctx, stmt->relation, ACCESS_MERGE);
+            stmt->withClause = NULL;
+            stmt->relation = NULL;
+            break;
+        }
+        default:
+            break;
+    }
+
+    result = raw_expression_tree_walker(node, reference_walker, (void*)ctx);
+    ctx->ctes = list_truncate(ctx->ctes, scope);
+    return result;
+}
+
+// Entry point for a top-level or nested statement. raw_expression_tree_walker
+// only knows the DML statements and raises an error for other statement nodes,
+// so those are either taken apart by walk_utility or skipped.
+static bool walk_statement(Node* node, ReferenceContext* ctx) {
+    bool handled;
+    bool result;
+    if (node == NULL) {
+        return false;
+    }
+    result = walk_utility(node, ctx, &handled);
+    if (handled) {
+        return result;
+    }
+    switch (nodeTag(node)) {
+        case T_SelectStmt:
+        case T_InsertStmt:
+        case T_UpdateStmt:
+        case T_DeleteStmt:
+        case T_MergeStmt:
+            return reference_walker(node, ctx);
+        default:
+            return false;
+    }
+}
+
+static const char* statement_type(Node* stmt) {
+    switch (nodeTag(stmt)) {
+#define STATEMENT_TYPE(name) case T_##name: return #name;
+        STATEMENT_TYPE(SelectStmt)
+        STATEMENT_TYPE(InsertStmt)
+        STATEMENT_TYPE(UpdateStmt)
+        STATEMENT_TYPE(DeleteStmt)
+        STATEMENT_TYPE(MergeStmt)
+        STATEMENT_TYPE(CreateStmt)
+        STATEMENT_TYPE(CreateTableAsStmt)
+        STATEMENT_TYPE(ViewStmt)
+        STATEMENT_TYPE(CreateSeqStmt)
+        STATEMENT_TYPE(AlterSeqStmt)
+        STATEMENT_TYPE(AlterTableStmt)
+        STATEMENT_TYPE(RenameStmt)
+        STATEMENT_TYPE(IndexStmt)
+        STATEMENT_TYPE(CreateTrigStmt)
+        STATEMENT_TYPE(RuleStmt)
+        STATEMENT_TYPE(DropStmt)
+        STATEMENT_TYPE(TruncateStmt)
+        STATEMENT_TYPE(CopyStmt)
+        STATEMENT_TYPE(LockStmt)
+        STATEMENT_TYPE(VacuumStmt)
+        STATEMENT_TYPE(ClusterStmt)
+        STATEMENT_TYPE(ReindexStmt)
+        STATEMENT_TYPE(RefreshMatViewStmt)
+        STATEMENT_TYPE(GrantStmt)
+        STATEMENT_TYPE(GrantRoleStmt)
+        STATEMENT_TYPE(CallStmt)
+        STATEMENT_TYPE(DoStmt)
+        STATEMENT_TYPE(ExplainStmt)
+        STATEMENT_TYPE(DeclareCursorStmt)
+        STATEMENT_TYPE(FetchStmt)
+        STATEMENT_TYPE(ClosePortalStmt)
+        STATEMENT_TYPE(PrepareStmt)
+        STATEMENT_TYPE(ExecuteStmt)
+        STATEMENT_TYPE(DeallocateStmt)
+        STATEMENT_TYPE(TransactionStmt)
+        STATEMENT_TYPE(VariableSetStmt)
+        STATEMENT_TYPE(VariableShowStmt)
+        STATEMENT_TYPE(DiscardStmt)
+        STATEMENT_TYPE(CreateSchemaStmt)
+        STATEMENT_TYPE(CreateFunctionStmt)
+        STATEMENT_TYPE(AlterFunctionStmt)
+        STATEMENT_TYPE(CreateRoleStmt)
+        STATEMENT_TYPE(AlterRoleStmt)
+        STATEMENT_TYPE(DropRoleStmt)
+        STATEMENT_TYPE(CreateExtensionStmt)
+        STATEMENT_TYPE(CreateDomainStmt)
+        STATEMENT_TYPE(CompositeTypeStmt)
+        STATEMENT_TYPE(CreateEnumStmt)
+        STATEMENT_TYPE(CommentStmt)
+        STATEMENT_TYPE(AlterOwnerStmt)
+        STATEMENT_TYPE(AlterDefaultPrivilegesStmt)
+        STATEMENT_TYPE(NotifyStmt)
+        STATEMENT_TYPE(ListenStmt)
+        STATEMENT_TYPE(UnlistenStmt)
+        STATEMENT_TYPE(CheckPointStmt)
+#undef STATEMENT_TYPE
+        default:
+            return "Other";
+    }
+}
+
+// Fills ctx from the statements in `tree`. Errors raised by the walker, such as
+// for a node type it does not know, are returned as a message instead.
+static char* collect_references(List* tree, ReferenceContext* ctx) {
+    MemoryContext walk_context = CurrentMemoryContext;
+    char* volatile message = NULL;
+
+    PG_TRY();
+    {
+        ListCell* lc;
+        foreach(lc, tree) {
+            RawStmt* raw = lfirst_node(RawStmt, lc);
+            int32_t record[3] = {
+                add_string(ctx, statement_type(raw->stmt)),
+                raw->stmt_location,
+                raw->stmt_len
+            };
+            appendBinaryStringInfo(&ctx->statements, (const char*)record, sizeof(record));
+            walk_statement(raw->stmt, ctx);
+            ctx->statement++;
+        }
+    }
+    PG_CATCH();
+    {
+        MemoryContextSwitchTo(walk_context);
+        ErrorData* error_data = CopyErrorData();
+        message = strdup(error_data->message);
+        FlushErrorState();
+    }
+    PG_END_TRY();
+
+    return message;
+}
+
+static PgQueryError* references_error(char* message) {
+    PgQueryError* error = (PgQueryError*)calloc(1, sizeof(PgQueryError));
+    if (error) {
+        error->message = message ? message : strdup("Memory allocation failed");
+    } else {
+        free(message);
+    }
+    return error;
+}
+
+EMSCRIPTEN_KEEPALIVE
+WasmReferencesResult* wasm_extract_references(const char* input) {
+    WasmReferencesResult* result = (WasmReferencesResult*)calloc(1, sizeof(WasmReferencesResult));
+    if (!result) {
+        return NULL;
+    }
+    if (!input || !*input) {
+        result->error = references_error(strdup("Invalid input: query cannot be null or empty"));
+        return result;
+    }
+
+    MemoryContext ctx_mem = pg_query_enter_memory_context();
+    PgQueryInternalParsetreeAndError parsed = TIMED(pg_query_raw_parse(input, PG_QUERY_PARSE_DEFAULT));
+    free(parsed.stderr_buffer);
+
+    if (parsed.error) {
+        // Allocated with malloc, so it outlives the memory context
+        result->error = parsed.error;
+    } else {
+        ReferenceContext ctx = {0};
+        initStringInfo(&ctx.relations);
+        initStringInfo(&ctx.functions);
+        initStringInfo(&ctx.statements);
+        initStringInfo(&ctx.strings);
+
+        char* message = TIMED(collect_references(parsed.tree, &ctx));
+        if (message) {
+            result->error = references_error(message);
+        } else {
+            int32_t strings_offset = REFERENCES_HEADER_WORDS * sizeof(int32_t) +
+                ctx.relations.len + ctx.functions.len + ctx.statements.len;
+            char* block = (char*)malloc(strings_offset + ctx.strings.len);
+            if (!block) {
+                result->error = references_error(NULL);
+            } else {
+                int32_t* header = (int32_t*)block;
+                header[0] = ctx.relations.len / (6 * sizeof(int32_t));
+                header[1] = ctx.functions.len / (4 * sizeof(int32_t));
+                header[2] = ctx.statements.len / (3 * sizeof(int32_t));
+                header[3] = strings_offset;
+                header[4] = strings_offset + ctx.strings.len;
+                char* out = block + REFERENCES_HEADER_WORDS * sizeof(int32_t);
+                memcpy(out, ctx.relations.data, ctx.relations.len);
+                out += ctx.relations.len;
+                memcpy(out, ctx.functions.data, ctx.functions.len);
+                out += ctx.functions.len;
+                memcpy(out, ctx.statements.data, ctx.statements.len);
+                out += ctx.statements.len;
+                memcpy(out, ctx.strings.data, ctx.strings.len);
+                result->block = header;
+            }
+        }
+    }
+
+    // Frees the tree and everything collected above
+    pg_query_exit_memory_context(ctx_mem);
+    return result;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_free_references_result(WasmReferencesResult* result) {
+    if (result) {
+        free(result->block);
+        if (result->error) {
+            free(result->error->message);
+            free(result->error->funcname);
+            free(result->error->filename);
+            free(result->error->context);
+            free(result->error);
+        }
+        free(result);
+    }
+}
@@ -1,10 +1,35 @@
 #include "pg_query.h"
 #include "protobuf/pg_query.pb-c.h"
-#include <emscripten.h>
+#include "wasm_wrapper.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <time.h>
+
+#ifdef __EMSCRIPTEN__
+#include <malloc.h>
+#endif
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+// From libpg_query's src/pg_query_internal.h, which cannot be included without
+// the PostgreSQL server headers. The tree is a List* and the context a
+// MemoryContext; both are only passed back to libpg_query.
+typedef struct {
+    void* tree;
+    char* stderr_buffer;
+    PgQueryError* error;
+} PgQueryInternalParsetreeAndError;
+
+PgQueryInternalParsetreeAndError pg_query_raw_parse(const char* input, int parser_options);
+void* pg_query_enter_memory_context(void);
+void pg_query_exit_memory_context(void* ctx);
+void pg_query_free_error(PgQueryError* error);
 
 static int validate_input(const char* input) {
     return input != NULL && strlen(input) > 0;
@@ -19,6 +44,15 @@ static char* safe_strdup(const char* str) {
     return result;
 }
 
+// Takes ownership of a string libpg_query allocated with malloc, leaving NULL in
+// its place so the pg_query_free_* call that follows skips it. Results are handed
+// to JS as-is instead of being copied; JS releases them with wasm_free_string.
+static char* take_string(char** field) {
+    char* str = *field;
+    *field = NULL;
+    return str;
+}
+
 static void* safe_malloc(size_t size) {
     void* ptr = malloc(size);
     if (!ptr && size > 0) {
@@ -27,21 +61,61 @@ static void* safe_malloc(size_t size) {
     return ptr;
 }
 
+// Time spent inside libpg_query, summed across calls while timing is on so JS
+// can tell it apart from the cost of copying inputs and decoding results.
+// Per thread: pool workers share one copy of the native addon per process.
+static _Thread_local int timing_enabled = 0;
+static _Thread_local double timing_ms = 0;
+
+static double clock_ms(void) {
+#ifdef __EMSCRIPTEN__
+    return emscripten_get_now();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+#endif
+}
+
+double timing_now(void) {
+    return timing_enabled ? clock_ms() : 0;
+}
+
+void timing_add(double started) {
+    if (timing_enabled) {
+        timing_ms += clock_ms() - started;
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_set_timing(int enabled) {
+    timing_enabled = enabled;
+    timing_ms = 0;
+}
+
+// Returns the libpg_query time since the last call, in milliseconds
+EMSCRIPTEN_KEEPALIVE
+double wasm_take_timing(void) {
+    double ms = timing_ms;
+    timing_ms = 0;
+    return ms;
+}
+
 EMSCRIPTEN_KEEPALIVE
 char* wasm_parse_query(const char* input) {
     if (!validate_input(input)) {
         return safe_strdup("Invalid input: query cannot be null or empty");
     }
     
-    PgQueryParseResult result = pg_query_parse(input);
+    PgQueryParseResult result = TIMED(pg_query_parse(input));
     
     if (result.error) {
-        char* error_msg = safe_strdup(result.error->message);
+        char* error_msg = take_string(&result.error->message);
         pg_query_free_parse_result(result);
         return error_msg ? error_msg : safe_strdup("Memory allocation failed");
     }
     
-    char* parse_tree = safe_strdup(result.parse_tree);
+    char* parse_tree = take_string(&result.parse_tree);
     pg_query_free_parse_result(result);
     return parse_tree;
 }
@@ -53,7 +127,7 @@ PgQueryParseResult* wasm_parse_query_raw(const char* input) {
         return NULL;
     }
     
-    *result = pg_query_parse(input);
+    *result = TIMED(pg_query_parse(input));
     return result;
 }
 
@@ -65,6 +139,73 @@ void wasm_free_parse_result(PgQueryParseResult* result) {
     }
 }
 
+// Parses `count` NUL-separated queries packed back to back in `inputs`.
+// Returns an array of `count` PgQueryParseResult structs in input order;
+// each entry carries either its parse tree or its own error record.
+EMSCRIPTEN_KEEPALIVE
+PgQueryParseResult* wasm_parse_batch(const char* inputs, int count) {
+    if (!inputs || count <= 0) {
+        return NULL;
+    }
+
+    PgQueryParseResult* results = (PgQueryParseResult*)safe_malloc(sizeof(PgQueryParseResult) * count);
+    if (!results) {
+        return NULL;
+    }
+
+    const char* input = inputs;
+    for (int i = 0; i < count; i++) {
+        results[i] = TIMED(pg_query_parse(input));
+        input += strlen(input) + 1;
+    }
+
+    return results;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_free_parse_batch(PgQueryParseResult* results, int count) {
+    if (results) {
+        for (int i = 0; i < count; i++) {
+            pg_query_free_parse_result(results[i]);
+        }
+        free(results);
+    }
+}
+
+// Batch syntax check: `inputs` holds `count` NUL-separated queries packed back
+// to back, as for wasm_parse_batch. Only the raw parser runs; the tree is
+// dropped with its memory context instead of being serialized. Returns the
+// number of invalid queries, or -1 on bad arguments.
+EMSCRIPTEN_KEEPALIVE
+int wasm_validate_batch(const char* inputs, int count, WasmValidateResult* out) {
+    if (!inputs || !out || count <= 0) {
+        return -1;
+    }
+
+    int failures = 0;
+    const char* input = inputs;
+    for (int i = 0; i < count; i++) {
+        void* ctx = pg_query_enter_memory_context();
+        PgQueryInternalParsetreeAndError result = TIMED(pg_query_raw_parse(input, PG_QUERY_PARSE_DEFAULT));
+        pg_query_exit_memory_context(ctx);
+
+        out[i].valid = result.error ? 0 : 1;
+        out[i].cursorpos = result.error ? result.error->cursorpos : 0;
+        out[i].message = result.error ? take_string(&result.error->message) : NULL;
+        if (result.error) {
+            if (!out[i].message) {
+                out[i].message = safe_strdup("Memory allocation failed");
+            }
+            pg_query_free_error(result.error);
+            failures++;
+        }
+        free(result.stderr_buffer);
+        input += strlen(input) + 1;
+    }
+
+    return failures;
+}
+
 EMSCRIPTEN_KEEPALIVE
 char* wasm_deparse_protobuf(const char* protobuf_data, size_t data_len) {
     if (!protobuf_data || data_len == 0) {
@@ -75,15 +216,15 @@ char* wasm_deparse_protobuf(const char* protobuf_data, size_t data_len) {
     pbuf.data = (char*)protobuf_data;
     pbuf.len = data_len;
     
-    PgQueryDeparseResult result = pg_query_deparse_protobuf(pbuf);
+    PgQueryDeparseResult result = TIMED(pg_query_deparse_protobuf(pbuf));
     
     if (result.error) {
-        char* error_msg = safe_strdup(result.error->message);
+        char* error_msg = take_string(&result.error->message);
         pg_query_free_deparse_result(result);
         return error_msg ? error_msg : safe_strdup("Memory allocation failed");
     }
     
-    char* query = safe_strdup(result.query);
+    char* query = take_string(&result.query);
     pg_query_free_deparse_result(result);
     return query;
 }
@@ -94,10 +235,10 @@ char* wasm_parse_plpgsql(const char* input) {
         return safe_strdup("Invalid input: query cannot be null or empty");
     }
     
-    PgQueryPlpgsqlParseResult result = pg_query_parse_plpgsql(input);
+    PgQueryPlpgsqlParseResult result = TIMED(pg_query_parse_plpgsql(input));
     
     if (result.error) {
-        char* error_msg = safe_strdup(result.error->message);
+        char* error_msg = take_string(&result.error->message);
         pg_query_free_plpgsql_parse_result(result);
         return error_msg ? error_msg : safe_strdup("Memory allocation failed");
     }
@@ -134,19 +275,46 @@ char* wasm_fingerprint(const char* input) {
         return safe_strdup("Invalid input: query cannot be null or empty");
     }
     
-    PgQueryFingerprintResult result = pg_query_fingerprint(input);
+    PgQueryFingerprintResult result = TIMED(pg_query_fingerprint(input));
     
     if (result.error) {
-        char* error_msg = safe_strdup(result.error->message);
+        char* error_msg = take_string(&result.error->message);
         pg_query_free_fingerprint_result(result);
         return error_msg ? error_msg : safe_strdup("Memory allocation failed");
     }
     
-    char* fingerprint_str = safe_strdup(result.fingerprint_str);
+    char* fingerprint_str = take_string(&result.fingerprint_str);
     pg_query_free_fingerprint_result(result);
     return fingerprint_str;
 }
 
+// Batch fingerprint: `inputs` holds `count` NUL-separated queries packed back to
+// back. Writes each raw 64-bit fingerprint to `out` (0 for queries that fail to
+// parse) and returns the number of failures, or -1 on invalid arguments.
+EMSCRIPTEN_KEEPALIVE
+int wasm_fingerprint_batch(const char* inputs, int count, uint64_t* out) {
+    if (!inputs || !out || count <= 0) {
+        return -1;
+    }
+
+    int failures = 0;
+    const char* input = inputs;
+    for (int i = 0; i < count; i++) {
+        if (*input) {
+            PgQueryFingerprintResult result = TIMED(pg_query_fingerprint(input));
+            out[i] = result.error ? 0 : result.fingerprint;
+            failures += result.error ? 1 : 0;
+            pg_query_free_fingerprint_result(result);
+        } else {
+            out[i] = 0;
+            failures++;
+        }
+        input += strlen(input) + 1;
+    }
+
+    return failures;
+}
+
 EMSCRIPTEN_KEEPALIVE
 char* wasm_parse_query_protobuf(const char* input, int* out_len) {
     if (!validate_input(input)) {
@@ -154,44 +322,42 @@ char* wasm_parse_query_protobuf(const char* input, int* out_len) {
         return safe_strdup("Invalid input: query cannot be null or empty");
     }
     
-    PgQueryProtobufParseResult result = pg_query_parse_protobuf(input);
+    PgQueryProtobufParseResult result = TIMED(pg_query_parse_protobuf(input));
     
     if (result.error) {
         *out_len = 0;
-        char* error_msg = safe_strdup(result.error->message);
+        char* error_msg = take_string(&result.error->message);
         pg_query_free_protobuf_parse_result(result);
         return error_msg ? error_msg : safe_strdup("Memory allocation failed");
     }
     
-    char* protobuf_data = safe_malloc(result.parse_tree.len);
-    if (!protobuf_data) {
-        pg_query_free_protobuf_parse_result(result);
-        *out_len = 0;
-        return NULL;
-    }
-    memcpy(protobuf_data, result.parse_tree.data, result.parse_tree.len);
+    char* protobuf_data = take_string(&result.parse_tree.data);
     *out_len = (int)result.parse_tree.len;
     
     pg_query_free_protobuf_parse_result(result);
     return protobuf_data;
 }
 
+// Returns libpg_query's protobuf parse result as-is. The caller reads the
+// length, data pointer and error straight from the struct, so the query is
+// parsed exactly once and the buffer is not copied inside the module.
 EMSCRIPTEN_KEEPALIVE
-int wasm_get_protobuf_len(const char* input) {
-    if (!validate_input(input)) {
-        return -1;
+PgQueryProtobufParseResult* wasm_parse_query_protobuf_raw(const char* input) {
+    PgQueryProtobufParseResult* result = (PgQueryProtobufParseResult*)safe_malloc(sizeof(PgQueryProtobufParseResult));
+    if (!result) {
+        return NULL;
     }
     
-    PgQueryProtobufParseResult result = pg_query_parse_protobuf(input);
-    
-    if (result.error) {
-        pg_query_free_protobuf_parse_result(result);
-        return -1;
+    *result = TIMED(pg_query_parse_protobuf(input));
+    return result;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_free_protobuf_parse_result(PgQueryProtobufParseResult* result) {
+    if (result) {
+        pg_query_free_protobuf_parse_result(*result);
+        free(result);
     }
-    
-    int len = (int)result.parse_tree.len;
-    pg_query_free_protobuf_parse_result(result);
-    return len;
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -200,15 +366,15 @@ char* wasm_normalize_query(const char* input) {
         return safe_strdup("Invalid input: query cannot be null or empty");
     }
     
-    PgQueryNormalizeResult result = pg_query_normalize(input);
+    PgQueryNormalizeResult result = TIMED(pg_query_normalize(input));
     
     if (result.error) {
-        char* error_msg = safe_strdup(result.error->message);
+        char* error_msg = take_string(&result.error->message);
         pg_query_free_normalize_result(result);
         return error_msg ? error_msg : safe_strdup("Memory allocation failed");
     }
     
-    char* normalized = safe_strdup(result.normalized_query);
+    char* normalized = take_string(&result.normalized_query);
     pg_query_free_normalize_result(result);
     
     if (!normalized) {
@@ -248,7 +414,7 @@ WasmDetailedResult* wasm_parse_query_detailed(const char* input) {
         return result;
     }
     
-    PgQueryParseResult parse_result = pg_query_parse(input);
+    PgQueryParseResult parse_result = TIMED(pg_query_parse(input));
     
     if (parse_result.error) {
         result->has_error = 1;
@@ -266,17 +432,13 @@ WasmDetailedResult* wasm_parse_query_detailed(const char* input) {
                 parse_result.error->lineno, 
                 parse_result.error->cursorpos);
         result->message = prefixed_message;
-        char* funcname_copy = parse_result.error->funcname ? safe_strdup(parse_result.error->funcname) : NULL;
-        char* filename_copy = parse_result.error->filename ? safe_strdup(parse_result.error->filename) : NULL;
-        char* context_copy = parse_result.error->context ? safe_strdup(parse_result.error->context) : NULL;
-        
-        result->funcname = funcname_copy;
-        result->filename = filename_copy;
+        result->funcname = take_string(&parse_result.error->funcname);
+        result->filename = take_string(&parse_result.error->filename);
         result->lineno = parse_result.error->lineno;
         result->cursorpos = parse_result.error->cursorpos;
-        result->context = context_copy;
+        result->context = take_string(&parse_result.error->context);
     } else {
-        result->data = safe_strdup(parse_result.parse_tree);
+        result->data = take_string(&parse_result.parse_tree);
         if (result->data) {
             result->data_len = strlen(result->data);
         } else {
@@ -422,10 +584,10 @@ char* wasm_scan(const char* input) {
         return safe_strdup("Invalid input: query cannot be null or empty");
     }
     
-    PgQueryScanResult result = pg_query_scan(input);
+    PgQueryScanResult result = TIMED(pg_query_scan(input));
     
     if (result.error) {
-        char* error_msg = safe_strdup(result.error->message);
+        char* error_msg = take_string(&result.error->message);
         pg_query_free_scan_result(result);
         return error_msg ? error_msg : safe_strdup("Memory allocation failed");
     }
@@ -449,7 +611,846 @@ char* wasm_scan(const char* input) {
     return json_result ? json_result : safe_strdup("{\"version\":0,\"tokens\":[]}");
 }
 
+// Minimal protobuf wire-format reading for wasm_scan_binary: the scan result is
+// flat enough to walk in place, without unpacking a struct per token
+static const uint8_t* read_varint(const uint8_t* p, const uint8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    int shift = 0;
+    while (p < end && shift < 64) {
+        uint8_t byte = *p++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return p;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+
+static const uint8_t* skip_field(const uint8_t* p, const uint8_t* end, int wire_type) {
+    uint64_t len;
+    switch (wire_type) {
+        case 0: return read_varint(p, end, &len);
+        case 1: return end - p >= 8 ? p + 8 : NULL;
+        case 2:
+            p = read_varint(p, end, &len);
+            return p && (uint64_t)(end - p) >= len ? p + len : NULL;
+        case 5: return end - p >= 4 ? p + 4 : NULL;
+        default: return NULL;
+    }
+}
+
+typedef struct {
+    int32_t start;
+    int32_t end;
+    int32_t token;
+    int32_t keyword_kind;
+} ScanToken;
+
+// Reads one ScanToken message body in [p, end), with protobuf defaults for
+// absent fields. Returns NULL if it is malformed.
+static const uint8_t* read_scan_token(const uint8_t* p, const uint8_t* end, ScanToken* token) {
+    uint64_t tag, value;
+    token->start = token->end = token->token = token->keyword_kind = 0;
+    while (p && p < end) {
+        p = read_varint(p, end, &tag);
+        if (p && (tag & 7) == 0) {
+            p = read_varint(p, end, &value);
+            switch (tag >> 3) {
+                case 1: token->start = (int32_t)value; break;
+                case 2: token->end = (int32_t)value; break;
+                case 4: token->token = (int32_t)value; break;
+                case 5: token->keyword_kind = (int32_t)value; break;
+            }
+        } else if (p) {
+            p = skip_field(p, end, tag & 7);
+        }
+    }
+    return p;
+}
+
+// Binary scan: returns one int32 block laid out as
+//   [version, count, start[count], end[count], tokenType[count], keywordKind[count]]
+// with offsets in bytes, or NULL with *error set to a malloc'd message.
+EMSCRIPTEN_KEEPALIVE
+int32_t* wasm_scan_binary(const char* input, char** error) {
+    *error = NULL;
+    if (!validate_input(input)) {
+        *error = safe_strdup("Invalid input: query cannot be null or empty");
+        return NULL;
+    }
+
+    PgQueryScanResult result = TIMED(pg_query_scan(input));
+    if (result.error) {
+        *error = take_string(&result.error->message);
+        pg_query_free_scan_result(result);
+        return NULL;
+    }
+
+    const uint8_t* data = (const uint8_t*)result.pbuf.data;
+    const uint8_t* data_end = data + result.pbuf.len;
+    const uint8_t* p;
+    uint64_t tag, value;
+
+    // First pass: count tokens to size the block
+    int malformed = 0;
+    size_t count = 0;
+    for (p = data; p < data_end; ) {
+        p = read_varint(p, data_end, &tag);
+        if (p && (tag >> 3) == 2) count++;
+        if (p) p = skip_field(p, data_end, tag & 7);
+        if (!p) {
+            malformed = 1;
+            break;
+        }
+    }
+    if (malformed) {
+        pg_query_free_scan_result(result);
+        *error = safe_strdup("Failed to read scan result");
+        return NULL;
+    }
+
+    int32_t* block = (int32_t*)safe_malloc(sizeof(int32_t) * (2 + 4 * count));
+    if (!block) {
+        pg_query_free_scan_result(result);
+        *error = safe_strdup("Memory allocation failed");
+        return NULL;
+    }
+
+    int32_t* starts = block + 2;
+    int32_t* ends = starts + count;
+    int32_t* token_types = ends + count;
+    int32_t* keyword_kinds = token_types + count;
+    block[0] = 0;
+    block[1] = (int32_t)count;
+
+    // Second pass: fill the columns, with protobuf defaults for absent fields
+    size_t i = 0;
+    for (p = data; p < data_end && !malformed; ) {
+        p = read_varint(p, data_end, &tag);
+        if (p && tag == ((1 << 3) | 0)) {
+            p = read_varint(p, data_end, &value);
+            block[0] = (int32_t)value;
+        } else if (p && tag == ((2 << 3) | 2)) {
+            uint64_t len;
+            p = read_varint(p, data_end, &len);
+            if (!p || (uint64_t)(data_end - p) < len) {
+                malformed = 1;
+                break;
+            }
+
+            ScanToken token;
+            p = read_scan_token(p, p + len, &token);
+            starts[i] = token.start;
+            ends[i] = token.end;
+            token_types[i] = token.token;
+            keyword_kinds[i] = token.keyword_kind;
+            i++;
+        } else if (p) {
+            p = skip_field(p, data_end, tag & 7);
+        }
+        malformed = !p;
+    }
+
+    pg_query_free_scan_result(result);
+
+    if (malformed || i != count) {
+        free(block);
+        *error = safe_strdup("Failed to read scan result");
+        return NULL;
+    }
+    return block;
+}
+
+// Normalize with constants: the normalized text plus, for each constant that
+// became a $n parameter, its parameter number, byte offset and length in the
+// original text and its literal kind. libpg_query does not expose the constant
+// locations it finds, so both texts are scanned and the token streams aligned:
+// they match everywhere except where constants were replaced.
+#define CONSTANT_INTEGER   0
+#define CONSTANT_FLOAT     1
+#define CONSTANT_STRING    2
+#define CONSTANT_BITSTRING 3
+#define CONSTANT_BOOLEAN   4
+#define CONSTANT_NULL      5
+#define CONSTANT_OTHER     6
+
+// Token columns of a wasm_scan_binary block
+typedef struct {
+    const char* text;
+    int32_t count;
+    const int32_t* start;
+    const int32_t* end;
+    const int32_t* token;
+} ScanColumns;
+
+static void scan_columns(const char* text, const int32_t* block, ScanColumns* columns) {
+    columns->text = text;
+    columns->count = block[1];
+    columns->start = block + 2;
+    columns->end = columns->start + columns->count;
+    columns->token = columns->end + columns->count;
+}
+
+static int same_token(const ScanColumns* a, int i, const ScanColumns* b, int j) {
+    int32_t len = a->end[i] - a->start[i];
+    return len == b->end[j] - b->start[j] &&
+        memcmp(a->text + a->start[i], b->text + b->start[j], len) == 0;
+}
+
+static int is_comment_token(int32_t token) {
+    return token == PG_QUERY__TOKEN__SQL_COMMENT || token == PG_QUERY__TOKEN__C_COMMENT;
+}
+
+static int32_t constant_kind(int32_t token) {
+    switch (token) {
+        case PG_QUERY__TOKEN__ICONST: return CONSTANT_INTEGER;
+        case PG_QUERY__TOKEN__FCONST: return CONSTANT_FLOAT;
+        case PG_QUERY__TOKEN__SCONST:
+        case PG_QUERY__TOKEN__USCONST: return CONSTANT_STRING;
+        case PG_QUERY__TOKEN__BCONST:
+        case PG_QUERY__TOKEN__XCONST: return CONSTANT_BITSTRING;
+        case PG_QUERY__TOKEN__TRUE_P:
+        case PG_QUERY__TOKEN__FALSE_P: return CONSTANT_BOOLEAN;
+        case PG_QUERY__TOKEN__NULL_P: return CONSTANT_NULL;
+        default: return CONSTANT_OTHER;
+    }
+}
+
+// Lines up the tokens of `original` and `normalized` and fills the constants
+// block. Returns NULL with *error set when the streams cannot be lined up.
+static int32_t* align_constants(const ScanColumns* original, const ScanColumns* normalized, char** error) {
+    // Every constant is at least one parameter token in the normalized text
+    int32_t* block = (int32_t*)safe_malloc(sizeof(int32_t) * (1 + 4 * normalized->count));
+    if (!block) {
+        *error = safe_strdup("Memory allocation failed");
+        return NULL;
+    }
+    int32_t* params = block + 1;
+    int32_t* locations = params + normalized->count;
+    int32_t* lengths = locations + normalized->count;
+    int32_t* kinds = lengths + normalized->count;
+
+    int32_t count = 0;
+    int i = 0;
+    int j = 0;
+    while (j < normalized->count) {
+        if (i < original->count && same_token(original, i, normalized, j)) {
+            i++;
+            j++;
+        } else if (i < original->count && normalized->token[j] == PG_QUERY__TOKEN__PARAM) {
+            // A negative number is folded into one constant with its sign
+            int first = i;
+            int32_t first_token = original->token[i];
+            if ((first_token == PG_QUERY__TOKEN__ASCII_45 || first_token == PG_QUERY__TOKEN__ASCII_43) &&
+                i + 1 < original->count) {
+                i++;
+            }
+            int32_t kind = constant_kind(original->token[i]);
+            i++;
+            // Anything else the constant spans (such as UESCAPE '!') runs up
+            // to the token that follows the parameter
+            if (j + 1 < normalized->count) {
+                while (i < original->count && !same_token(original, i, normalized, j + 1) &&
+                       !is_comment_token(original->token[i])) {
+                    i++;
+                }
+            }
+            params[count] = (int32_t)strtol(normalized->text + normalized->start[j] + 1, NULL, 10);
+            locations[count] = original->start[first];
+            lengths[count] = original->end[i - 1] - original->start[first];
+            kinds[count] = kind;
+            count++;
+            j++;
+        } else if (i < original->count && is_comment_token(original->token[i])) {
+            i++;
+        } else if (is_comment_token(normalized->token[j])) {
+            j++;
+        } else {
+            free(block);
+            *error = safe_strdup("Failed to match normalized query to its input");
+            return NULL;
+        }
+    }
+
+    // Compact the columns to `count` entries
+    block[0] = count;
+    memmove(block + 1 + count, locations, sizeof(int32_t) * count);
+    memmove(block + 1 + 2 * count, lengths, sizeof(int32_t) * count);
+    memmove(block + 1 + 3 * count, kinds, sizeof(int32_t) * count);
+    return block;
+}
+
+static void normalize_with_constants(const char* input, WasmNormalizeResult* out) {
+    out->normalized_query = NULL;
+    out->constants = NULL;
+    out->error = NULL;
+    if (!validate_input(input)) {
+        out->error = safe_strdup("Invalid input: query cannot be null or empty");
+        return;
+    }
+
+    PgQueryNormalizeResult normalized = TIMED(pg_query_normalize(input));
+    if (normalized.error) {
+        out->error = take_string(&normalized.error->message);
+        pg_query_free_normalize_result(normalized);
+        if (!out->error) {
+            out->error = safe_strdup("Memory allocation failed");
+        }
+        return;
+    }
+    out->normalized_query = take_string(&normalized.normalized_query);
+    pg_query_free_normalize_result(normalized);
+
+    int32_t* original_scan = wasm_scan_binary(input, &out->error);
+    int32_t* normalized_scan = original_scan ? wasm_scan_binary(out->normalized_query, &out->error) : NULL;
+    if (normalized_scan) {
+        ScanColumns original_columns;
+        ScanColumns normalized_columns;
+        scan_columns(input, original_scan, &original_columns);
+        scan_columns(out->normalized_query, normalized_scan, &normalized_columns);
+        out->constants = align_constants(&original_columns, &normalized_columns, &out->error);
+    }
+    free(original_scan);
+    free(normalized_scan);
+
+    if (!out->constants) {
+        free(out->normalized_query);
+        out->normalized_query = NULL;
+        if (!out->error) {
+            out->error = safe_strdup("Memory allocation failed");
+        }
+    }
+}
+
+// Batch normalize with constants: `inputs` holds `count` NUL-separated queries
+// packed back to back, as for wasm_parse_batch. Fills one WasmNormalizeResult
+// per query and returns the number of failures, or -1 on bad arguments.
+EMSCRIPTEN_KEEPALIVE
+int wasm_normalize_batch(const char* inputs, int count, WasmNormalizeResult* out) {
+    if (!inputs || !out || count <= 0) {
+        return -1;
+    }
+
+    int failures = 0;
+    const char* input = inputs;
+    for (int i = 0; i < count; i++) {
+        normalize_with_constants(input, &out[i]);
+        failures += out[i].error ? 1 : 0;
+        input += strlen(input) + 1;
+    }
+
+    return failures;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_free_normalize_batch(WasmNormalizeResult* results, int count) {
+    if (results) {
+        for (int i = 0; i < count; i++) {
+            free(results[i].normalized_query);
+            free(results[i].constants);
+            free(results[i].error);
+        }
+        free(results);
+    }
+}
+
+// Fast scan: the same token columns as wasm_scan_binary, without running the
+// whole input through pg_query_scan. Whitespace, plain ASCII identifiers and
+// keywords, small integers and the punctuation , ; ( ) [ ] are lexed here,
+// 16 bytes at a time when built with SIMD. Everything else (strings, comments,
+// operators, parameters, non-ASCII text) is handed to pg_query_scan a small
+// window at a time, so its tokens come from the PostgreSQL lexer itself.
+
+#define FAST_SCAN_WINDOW 64
+// Bytes of lookahead the PostgreSQL lexer may need past the end of a token
+#define FAST_SCAN_LOOKAHEAD 8
+
+typedef struct {
+    const char* name;
+    int32_t token;
+    int32_t keyword_kind;
+} FastScanKeyword;
+
+// kwlist.h is sorted by name, which keeps this table ready for binary search
+#define PG_KEYWORD(kwname, value, category, ...) \
+    { kwname, PG_QUERY__TOKEN__##value, PG_QUERY__KEYWORD_KIND__##category },
+static const FastScanKeyword fast_scan_keywords[] = {
+#include "src/postgres/include/parser/kwlist.h"
+};
+#undef PG_KEYWORD
+
+typedef struct {
+    ScanToken* items;
+    size_t count;
+    size_t capacity;
+} ScanTokenList;
+
+static int push_scan_token(ScanTokenList* list, int32_t start, int32_t end, int32_t token, int32_t keyword_kind) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        ScanToken* items = (ScanToken*)realloc(list->items, sizeof(ScanToken) * capacity);
+        if (!items) {
+            return 0;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    ScanToken* item = &list->items[list->count++];
+    item->start = start;
+    item->end = end;
+    item->token = token;
+    item->keyword_kind = keyword_kind;
+    return 1;
+}
+
+static int is_sql_space(uint8_t c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static int is_ident_char(uint8_t c) {
+    return (uint8_t)((c | 0x20) - 'a') < 26 || (uint8_t)(c - '0') < 10 || c == '_';
+}
+
+// Punctuation that always lexes as a single-character token of its own
+static int is_self_char(uint8_t c) {
+    return c == ',' || c == ';' || c == '(' || c == ')' || c == '[' || c == ']';
+}
+
+// Returns the end of the run starting at `pos` of whitespace (ident = 0) or of
+// ASCII identifier characters (ident = 1)
+static size_t scan_run(const uint8_t* s, size_t pos, size_t len, int ident) {
+#ifdef __wasm_simd128__
+    while (pos + 16 <= len) {
+        v128_t v = wasm_v128_load(s + pos);
+        v128_t match;
+        if (ident) {
+            v128_t lower = wasm_v128_or(v, wasm_i8x16_splat(0x20));
+            v128_t alpha = wasm_v128_and(wasm_u8x16_ge(lower, wasm_i8x16_splat('a')),
+                                         wasm_u8x16_le(lower, wasm_i8x16_splat('z')));
+            v128_t digit = wasm_v128_and(wasm_u8x16_ge(v, wasm_i8x16_splat('0')),
+                                         wasm_u8x16_le(v, wasm_i8x16_splat('9')));
+            match = wasm_v128_or(wasm_v128_or(alpha, digit), wasm_i8x16_eq(v, wasm_i8x16_splat('_')));
+        } else {
+            v128_t control = wasm_v128_and(wasm_u8x16_ge(v, wasm_i8x16_splat('\t')),
+                                           wasm_u8x16_le(v, wasm_i8x16_splat('\r')));
+            match = wasm_v128_or(control, wasm_i8x16_eq(v, wasm_i8x16_splat(' ')));
+        }
+        uint32_t mask = (uint32_t)wasm_i8x16_bitmask(match);
+        if (mask != 0xffff) {
+            return pos + __builtin_ctz(~mask);
+        }
+        pos += 16;
+    }
+#endif
+    while (pos < len && (ident ? is_ident_char(s[pos]) : is_sql_space(s[pos]))) {
+        pos++;
+    }
+    return pos;
+}
+
+static const FastScanKeyword* find_keyword(const uint8_t* s, size_t len) {
+    char name[64];
+    if (len >= sizeof(name)) {
+        return NULL;
+    }
+    for (size_t i = 0; i < len; i++) {
+        name[i] = (char)((s[i] >= 'A' && s[i] <= 'Z') ? s[i] + ('a' - 'A') : s[i]);
+    }
+    name[len] = '\0';
+
+    size_t lo = 0, hi = sizeof(fast_scan_keywords) / sizeof(fast_scan_keywords[0]);
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int cmp = strcmp(name, fast_scan_keywords[mid].name);
+        if (cmp == 0) {
+            return &fast_scan_keywords[mid];
+        }
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+// Lexes from `pos`, a token boundary, by running pg_query_scan over a window of
+// the input. Tokens that end too close to the window's edge to be trusted are
+// dropped, and the window grows when nothing usable comes back (e.g. a string
+// literal longer than the window). Returns the end of the last token kept, or
+// SIZE_MAX with *error set.
+static size_t scan_window(const char* input, size_t pos, size_t len, ScanTokenList* tokens, char** error) {
+    size_t window = FAST_SCAN_WINDOW;
+    for (;;) {
+        size_t end = len - pos <= window ? len : pos + window;
+        char* chunk = (char*)safe_malloc(end - pos + 1);
+        if (!chunk) {
+            *error = safe_strdup("Memory allocation failed");
+            return SIZE_MAX;
+        }
+        memcpy(chunk, input + pos, end - pos);
+        chunk[end - pos] = '\0';
+        PgQueryScanResult result = TIMED(pg_query_scan(chunk));
+        free(chunk);
+
+        if (result.error) {
+            // Only an error that persists to the end of the input is real; a
+            // window can cut a string or comment in half
+            if (end == len) {
+                *error = take_string(&result.error->message);
+                pg_query_free_scan_result(result);
+                return SIZE_MAX;
+            }
+            pg_query_free_scan_result(result);
+            window *= 2;
+            continue;
+        }
+
+        const uint8_t* p = (const uint8_t*)result.pbuf.data;
+        const uint8_t* data_end = p + result.pbuf.len;
+        size_t next = pos;
+        uint64_t tag, field_len;
+        ScanToken pending;
+        int has_pending = 0, ok = 1;
+        while (p && p < data_end) {
+            p = read_varint(p, data_end, &tag);
+            if (p && tag == ((2 << 3) | 2)) {
+                ScanToken token;
+                p = read_varint(p, data_end, &field_len);
+                if (!p || (uint64_t)(data_end - p) < field_len) {
+                    p = NULL;
+                    break;
+                }
+                p = read_scan_token(p, p + field_len, &token);
+                if (!p) {
+                    break;
+                }
+                // A token is only kept once the next one has been seen: string
+                // literals continue across a newline, so the lexer cannot
+                // settle one until it reaches whatever follows it
+                if (has_pending) {
+                    ok = push_scan_token(tokens, (int32_t)pos + pending.start, (int32_t)pos + pending.end,
+                                         pending.token, pending.keyword_kind);
+                    next = pos + pending.end;
+                    has_pending = 0;
+                    if (!ok) {
+                        break;
+                    }
+                }
+                if (end != len && pos + token.end + FAST_SCAN_LOOKAHEAD > end) {
+                    break;
+                }
+                pending = token;
+                has_pending = 1;
+            } else if (p) {
+                p = skip_field(p, data_end, tag & 7);
+            }
+        }
+        if (p && ok && has_pending && end == len) {
+            ok = push_scan_token(tokens, (int32_t)pos + pending.start, (int32_t)pos + pending.end,
+                                 pending.token, pending.keyword_kind);
+            next = pos + pending.end;
+        }
+        pg_query_free_scan_result(result);
+
+        if (!ok) {
+            *error = safe_strdup("Memory allocation failed");
+            return SIZE_MAX;
+        }
+        if (!p) {
+            *error = safe_strdup("Failed to read scan result");
+            return SIZE_MAX;
+        }
+        if (next > pos || end == len) {
+            return end == len && next == pos ? len : next;
+        }
+        window *= 2;
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+int32_t* wasm_scan_fast(const char* input, char** error) {
+    *error = NULL;
+    if (!validate_input(input)) {
+        *error = safe_strdup("Invalid input: query cannot be null or empty");
+        return NULL;
+    }
+
+    const uint8_t* s = (const uint8_t*)input;
+    size_t len = strlen(input);
+    ScanTokenList tokens = { NULL, 0, 0 };
+    size_t pos = 0;
+    int ok = 1;
+
+    while (ok && pos < len) {
+        uint8_t c = s[pos];
+        if (is_sql_space(c)) {
+            pos = scan_run(s, pos, len, 0);
+            continue;
+        }
+        if (is_self_char(c)) {
+            ok = push_scan_token(&tokens, (int32_t)pos, (int32_t)pos + 1, c, PG_QUERY__KEYWORD_KIND__NO_KEYWORD);
+            pos++;
+            continue;
+        }
+        if (is_ident_char(c)) {
+            size_t end = scan_run(s, pos, len, 1);
+            // Anything else right after the run ($, ', ., non-ASCII, ...) can
+            // change how the run itself lexes
+            if (end == len || is_sql_space(s[end]) || is_self_char(s[end])) {
+                if (c >= '0' && c <= '9') {
+                    size_t digits = pos;
+                    while (digits < end && s[digits] >= '0' && s[digits] <= '9') {
+                        digits++;
+                    }
+                    // Up to 9 digits always fits an ICONST; longer may be an FCONST
+                    if (digits == end && end - pos <= 9) {
+                        ok = push_scan_token(&tokens, (int32_t)pos, (int32_t)end, PG_QUERY__TOKEN__ICONST,
+                                             PG_QUERY__KEYWORD_KIND__NO_KEYWORD);
+                        pos = end;
+                        continue;
+                    }
+                } else {
+                    const FastScanKeyword* keyword = find_keyword(s + pos, end - pos);
+                    ok = keyword
+                        ? push_scan_token(&tokens, (int32_t)pos, (int32_t)end, keyword->token, keyword->keyword_kind)
+                        : push_scan_token(&tokens, (int32_t)pos, (int32_t)end, PG_QUERY__TOKEN__IDENT,
+                                          PG_QUERY__KEYWORD_KIND__NO_KEYWORD);
+                    pos = end;
+                    continue;
+                }
+            }
+        }
+
+        pos = scan_window(input, pos, len, &tokens, error);
+        if (pos == SIZE_MAX) {
+            free(tokens.items);
+            return NULL;
+        }
+    }
+
+    if (!ok) {
+        free(tokens.items);
+        *error = safe_strdup("Memory allocation failed");
+        return NULL;
+    }
+
+    size_t count = tokens.count;
+    int32_t* block = (int32_t*)safe_malloc(sizeof(int32_t) * (2 + 4 * count));
+    if (!block) {
+        free(tokens.items);
+        *error = safe_strdup("Memory allocation failed");
+        return NULL;
+    }
+    block[0] = PG_VERSION_NUM;
+    block[1] = (int32_t)count;
+    for (size_t i = 0; i < count; i++) {
+        block[2 + i] = tokens.items[i].start;
+        block[2 + count + i] = tokens.items[i].end;
+        block[2 + 2 * count + i] = tokens.items[i].token;
+        block[2 + 3 * count + i] = tokens.items[i].keyword_kind;
+    }
+    free(tokens.items);
+    return block;
+}
+
+// Byte offset of a 1-based character position in UTF-8 `input`, as libpg_query
+// reports error cursors
+static size_t cursor_byte_offset(const char* input, int cursorpos) {
+    size_t offset = 0;
+    for (int chars = 1; input[offset] && chars < cursorpos; offset++) {
+        if ((input[offset + 1] & 0xC0) != 0x80) {
+            chars++;
+        }
+    }
+    return offset;
+}
+
+// Statement split: returns one int32 block laid out as
+//   [count, errorAt, location0, length0, location1, length1, ...]
+// with byte offsets into `input`, or NULL with *error set to a malloc'd message.
+// When the scanner fails (an unterminated string or comment), errorAt is the
+// byte offset of the failing token and only the statements that end with a
+// semicolon before it are listed; otherwise errorAt is -1.
+EMSCRIPTEN_KEEPALIVE
+int32_t* wasm_split_statements(const char* input, char** error) {
+    *error = NULL;
+    if (!validate_input(input)) {
+        *error = safe_strdup("Invalid input: query cannot be null or empty");
+        return NULL;
+    }
+
+    PgQuerySplitResult result = TIMED(pg_query_split_with_scanner(input));
+    int32_t error_at = -1;
+    if (result.error) {
+        if (result.error->cursorpos <= 0) {
+            *error = take_string(&result.error->message);
+            pg_query_free_split_result(result);
+            return NULL;
+        }
+        size_t prefix_len = cursor_byte_offset(input, result.error->cursorpos);
+        pg_query_free_split_result(result);
+
+        char* prefix = (char*)safe_malloc(prefix_len + 1);
+        if (!prefix) {
+            *error = safe_strdup("Memory allocation failed");
+            return NULL;
+        }
+        memcpy(prefix, input, prefix_len);
+        prefix[prefix_len] = '\0';
+        result = TIMED(pg_query_split_with_scanner(prefix));
+        free(prefix);
+        if (result.error) {
+            *error = take_string(&result.error->message);
+            pg_query_free_split_result(result);
+            return NULL;
+        }
+        error_at = (int32_t)prefix_len;
+    }
+
+    int32_t* block = (int32_t*)safe_malloc(sizeof(int32_t) * (2 + 2 * result.n_stmts));
+    if (!block) {
+        pg_query_free_split_result(result);
+        *error = safe_strdup("Memory allocation failed");
+        return NULL;
+    }
+
+    int count = 0;
+    for (int i = 0; i < result.n_stmts; i++) {
+        int location = result.stmts[i]->stmt_location;
+        int length = result.stmts[i]->stmt_len;
+        // Before an error, the statement cut short by it runs to the end
+        if (error_at >= 0 && (length == 0 || input[location + length] != ';')) {
+            continue;
+        }
+        block[2 + 2 * count] = location;
+        block[3 + 2 * count] = length;
+        count++;
+    }
+    block[0] = count;
+    block[1] = error_at;
+
+    pg_query_free_split_result(result);
+    return block;
+}
+
+// Case-insensitive search for an ASCII word in [start, start + len)
+static int contains_word(const char* start, size_t len, const char* word) {
+    size_t word_len = strlen(word);
+    for (size_t i = 0; i + word_len <= len; i++) {
+        if (strncasecmp(start + i, word, word_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// A PL/pgSQL function definition names both; anything else is skipped without
+// being parsed. False positives cost a parse and produce no entry.
+static int may_define_plpgsql(const char* stmt, size_t len) {
+    return contains_word(stmt, len, "plpgsql") &&
+        (contains_word(stmt, len, "function") || contains_word(stmt, len, "procedure"));
+}
+
+// Bulk PL/pgSQL parse: splits a whole dump with the scanner, picks out the
+// CREATE FUNCTION/PROCEDURE ... LANGUAGE plpgsql statements and parses each
+// body on its own, so one broken function does not hide the others. Returns
+// NULL with *error set only when the dump cannot be split.
+EMSCRIPTEN_KEEPALIVE
+WasmPlpgsqlDumpResult* wasm_parse_plpgsql_dump(const char* input, char** error) {
+    *error = NULL;
+    if (!validate_input(input)) {
+        *error = safe_strdup("Invalid input: query cannot be null or empty");
+        return NULL;
+    }
+
+    PgQuerySplitResult split = TIMED(pg_query_split_with_scanner(input));
+    if (split.error) {
+        *error = take_string(&split.error->message);
+        pg_query_free_split_result(split);
+        return NULL;
+    }
+
+    WasmPlpgsqlDumpResult* result = (WasmPlpgsqlDumpResult*)calloc(1, sizeof(WasmPlpgsqlDumpResult));
+    if (result && split.n_stmts > 0) {
+        result->functions = (WasmPlpgsqlFunction*)calloc(split.n_stmts, sizeof(WasmPlpgsqlFunction));
+    }
+    if (!result || (split.n_stmts > 0 && !result->functions)) {
+        free(result);
+        pg_query_free_split_result(split);
+        *error = safe_strdup("Memory allocation failed");
+        return NULL;
+    }
+
+    size_t input_len = strlen(input);
+    for (int i = 0; i < split.n_stmts; i++) {
+        int32_t location = split.stmts[i]->stmt_location;
+        // A zero length runs to the end of the input, as in RawStmt
+        int32_t length = split.stmts[i]->stmt_len ? split.stmts[i]->stmt_len : (int32_t)(input_len - location);
+        if (!may_define_plpgsql(input + location, length)) {
+            continue;
+        }
+
+        char* stmt = (char*)safe_malloc(length + 1);
+        WasmPlpgsqlFunction* function = &result->functions[result->count];
+        function->location = location;
+        function->length = length;
+        if (!stmt) {
+            function->error = safe_strdup("Memory allocation failed");
+            result->count++;
+            continue;
+        }
+        memcpy(stmt, input + location, length);
+        stmt[length] = '\0';
+
+        PgQueryPlpgsqlParseResult parsed = TIMED(pg_query_parse_plpgsql(stmt));
+        free(stmt);
+        if (parsed.error) {
+            function->error = take_string(&parsed.error->message);
+            function->cursorpos = parsed.error->cursorpos;
+            if (!function->error) {
+                function->error = safe_strdup("Memory allocation failed");
+            }
+            result->count++;
+        } else if (parsed.plpgsql_funcs && strchr(parsed.plpgsql_funcs, '{')) {
+            // An empty array means the statement was not a PL/pgSQL definition
+            function->plpgsql_funcs = take_string(&parsed.plpgsql_funcs);
+            result->count++;
+        }
+        pg_query_free_plpgsql_parse_result(parsed);
+    }
+
+    pg_query_free_split_result(split);
+    return result;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_free_plpgsql_dump(WasmPlpgsqlDumpResult* result) {
+    if (result) {
+        for (int i = 0; i < result->count; i++) {
+            free(result->functions[i].plpgsql_funcs);
+            free(result->functions[i].error);
+        }
+        free(result->functions);
+        free(result);
+    }
+}
+
 EMSCRIPTEN_KEEPALIVE
 void wasm_free_string(char* str) {
     free(str);
 }
+
+#ifdef __EMSCRIPTEN__
+// Bytes currently handed out by malloc. Linear memory itself never shrinks, so
+// this is the only way to tell a busy heap from one that grew once and emptied.
+// WASM only: the native addon has no linear memory to report on, and glibc
+// deprecates mallinfo().
+EMSCRIPTEN_KEEPALIVE
+size_t wasm_heap_used(void) {
+    struct mallinfo info = mallinfo();
+    return info.uordblks;
+}
+#endif
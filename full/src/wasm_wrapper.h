@@ -0,0 +1,120 @@
+#ifndef WASM_WRAPPER_H
+#define WASM_WRAPPER_H
+
+// Shared by the wrapper's translation units and by the native addon, which
+// links the same sources into a Node-API module instead of the WASM binary.
+// references.c and the analyze*.c files are compiled against the PostgreSQL
+// server headers, which wasm_wrapper.c keeps out of its scope.
+
+#include "pg_query.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+// Timing of libpg_query calls for wasm_take_timing(); both are no-ops while
+// timing is off
+double timing_now(void);
+void timing_add(double started);
+
+#define TIMED(call) ({ \
+    double timed_started_ = timing_now(); \
+    __typeof__(call) timed_result_ = (call); \
+    timing_add(timed_started_); \
+    timed_result_; \
+})
+
+// Outcome of one query in wasm_validate_batch: valid is 1 when it parsed.
+// Otherwise cursorpos is the 1-based error position (0 when unknown) and
+// message the error text, which JS frees with wasm_free_string.
+typedef struct {
+    int32_t valid;
+    int32_t cursorpos;
+    char* message;
+} WasmValidateResult;
+
+#define ANALYZE_PARSE       1
+#define ANALYZE_NORMALIZE   2
+#define ANALYZE_FINGERPRINT 4
+#define ANALYZE_SCAN        8
+
+typedef struct {
+    char* parse_tree;
+    char* normalized_query;
+    char* fingerprint_str;
+    int32_t* scan;  // Same block as wasm_scan_binary
+    PgQueryError* error;
+} WasmAnalyzeResult;
+
+// Outcome of one query in wasm_normalize_batch. On success constants is one
+// int32 block laid out as
+//   [count, param[count], location[count], length[count], kind[count]]
+// On failure normalized_query and constants are NULL and error is set.
+typedef struct {
+    char* normalized_query;
+    int32_t* constants;
+    char* error;
+} WasmNormalizeResult;
+
+// One function found by wasm_parse_plpgsql_dump: the byte span of its CREATE
+// statement in the dump and either the plpgsql_funcs JSON for it or an error
+// message with its 1-based cursor position in the statement (0 when unknown)
+typedef struct {
+    int32_t location;
+    int32_t length;
+    char* plpgsql_funcs;
+    char* error;
+    int32_t cursorpos;
+} WasmPlpgsqlFunction;
+
+typedef struct {
+    int32_t count;
+    WasmPlpgsqlFunction* functions;
+} WasmPlpgsqlDumpResult;
+
+typedef struct {
+    int32_t* block;       // See the layout in references.c
+    PgQueryError* error;
+} WasmReferencesResult;
+
+void wasm_set_timing(int enabled);
+double wasm_take_timing(void);
+void wasm_free_string(char* str);
+
+PgQueryParseResult* wasm_parse_query_raw(const char* input);
+void wasm_free_parse_result(PgQueryParseResult* result);
+PgQueryParseResult* wasm_parse_batch(const char* inputs, int count);
+void wasm_free_parse_batch(PgQueryParseResult* results, int count);
+PgQueryProtobufParseResult* wasm_parse_query_protobuf_raw(const char* input);
+void wasm_free_protobuf_parse_result(PgQueryProtobufParseResult* result);
+int wasm_validate_batch(const char* inputs, int count, WasmValidateResult* out);
+char* wasm_deparse_protobuf(const char* protobuf_data, size_t data_len);
+char* wasm_parse_plpgsql(const char* input);
+char* wasm_fingerprint(const char* input);
+int wasm_fingerprint_batch(const char* inputs, int count, uint64_t* out);
+char* wasm_normalize_query(const char* input);
+int wasm_normalize_batch(const char* inputs, int count, WasmNormalizeResult* out);
+void wasm_free_normalize_batch(WasmNormalizeResult* results, int count);
+char* wasm_scan(const char* input);
+int32_t* wasm_scan_binary(const char* input, char** error);
+int32_t* wasm_scan_fast(const char* input, char** error);
+WasmAnalyzeResult* wasm_analyze(const char* input, int flags);
+void wasm_free_analyze_result(WasmAnalyzeResult* result);
+
+// libpg_query's fingerprint and normalize walkers, run on a tree from
+// pg_query_raw_parse (a List*) instead of parsing the text again. Compiled from
+// its own sources in analyze_fingerprint.c and analyze_normalize.c; free the
+// results with pg_query_free_fingerprint_result / pg_query_free_normalize_result.
+PgQueryFingerprintResult analyze_fingerprint(void* tree);
+PgQueryNormalizeResult analyze_normalize(const char* input, void* tree);
+WasmReferencesResult* wasm_extract_references(const char* input);
+void wasm_free_references_result(WasmReferencesResult* result);
+int32_t* wasm_split_statements(const char* input, char** error);
+WasmPlpgsqlDumpResult* wasm_parse_plpgsql_dump(const char* input, char** error);
+void wasm_free_plpgsql_dump(WasmPlpgsqlDumpResult* result);
+
+#endif
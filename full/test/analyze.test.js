@@ -0,0 +1,58 @@
+const query = require("../");
+const { describe, it, before } = require('node:test');
+const assert = require('node:assert/strict');
+
+describe("Analyze", () => {
+  const sql = "SELECT * FROM users WHERE id = 42 AND name = 'bob'";
+
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should return parse, normalize and fingerprint by default", async () => {
+    const result = await query.analyze(sql);
+    assert.deepEqual(result.parseTree, query.parseSync(sql));
+    assert.equal(result.normalized, query.normalizeSync(sql));
+    assert.equal(result.fingerprint, query.fingerprintSync(sql));
+    assert.equal(result.scan, undefined);
+  });
+
+  it("should match the separate calls for several statements", () => {
+    const statements = "SELECT a FROM t WHERE b IN (1, 2, 3); UPDATE t SET a = 'x' WHERE id = $1; CREATE TABLE u (id int)";
+    const result = query.analyzeSync(statements);
+    assert.deepEqual(result.parseTree, query.parseSync(statements));
+    assert.equal(result.normalized, query.normalizeSync(statements));
+    assert.equal(result.fingerprint, query.fingerprintSync(statements));
+  });
+
+  it("should return only the requested outputs", () => {
+    const result = query.analyzeSync(sql, { fingerprint: true, scan: true });
+    assert.deepEqual(Object.keys(result).sort(), ["fingerprint", "scan"]);
+    assert.equal(result.fingerprint, query.fingerprintSync(sql));
+
+    const binary = query.scanBinarySync(sql);
+    assert.equal(result.scan.count, binary.count);
+    assert.deepEqual(Array.from(result.scan.tokenType), Array.from(binary.tokenType));
+    assert.equal(result.scan.text(0), "SELECT");
+  });
+
+  it("should throw a SqlError like parse on invalid SQL", () => {
+    let expected;
+    try {
+      query.parseSync("SELECT FROM WHERE");
+    } catch (error) {
+      expected = error;
+    }
+    assert.ok(expected);
+    assert.throws(() => query.analyzeSync("SELECT FROM WHERE"), (error) => {
+      assert.ok(error instanceof query.SqlError);
+      assert.equal(error.message, expected.message);
+      assert.equal(error.sqlDetails.cursorPosition, expected.sqlDetails.cursorPosition);
+      return true;
+    });
+  });
+
+  it("should reject empty input", () => {
+    assert.throws(() => query.analyzeSync(""), /empty/);
+  });
+});
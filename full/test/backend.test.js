@@ -0,0 +1,42 @@
+const query = require("../");
+const { describe, it, before } = require('node:test');
+const assert = require('node:assert/strict');
+
+describe("Backend", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should report the backend in use", () => {
+    const expected = process.env.LIBPG_QUERY_BACKEND;
+    const backend = query.getBackend();
+    assert.ok(backend === "native" || backend === "wasm");
+    if (expected === "native" || expected === "wasm") {
+      assert.equal(backend, expected);
+    }
+  });
+
+  it("should keep the heap APIs available", () => {
+    assert.ok(query.getHeapStats().memoryBytes > 0);
+  });
+
+  it("should pick the same backend in the ES module build", () => {
+    const { execFileSync } = require('node:child_process');
+    const { pathToFileURL } = require('node:url');
+    const entry = pathToFileURL(require.resolve("../wasm/index.js")).href;
+    const backend = execFileSync(process.execPath, ["--input-type=module", "-e", `
+      const query = await import(${JSON.stringify(entry)});
+      await query.loadModule();
+      process.stdout.write(query.getBackend());
+    `], { encoding: "utf8" });
+    assert.equal(backend, query.getBackend());
+  });
+
+  it("should report errors with SQL details", () => {
+    assert.throws(() => query.parseSync("SELECT * FROM users WHERE id = @"), (error) => {
+      assert.ok(query.hasSqlDetails(error));
+      assert.equal(error.sqlDetails.cursorPosition, 32);
+      return true;
+    });
+  });
+});
@@ -0,0 +1,82 @@
+const query = require("../");
+const { describe, it, before, afterEach } = require('node:test');
+const assert = require('node:assert/strict');
+
+describe("Query Cache", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  afterEach(() => {
+    query.disableCache();
+  });
+
+  it("should be disabled by default", () => {
+    assert.equal(query.getCacheStats(), null);
+    assert.notEqual(query.parseSync("select 1"), query.parseSync("select 1"));
+  });
+
+  it("should return cached parse trees on repeated queries", async () => {
+    query.enableCache({ maxBytes: 1024 * 1024 });
+    const first = query.parseSync("select * from users");
+    const second = await query.parse("select * from users");
+    assert.equal(first, second);
+
+    const stats = query.getCacheStats();
+    assert.equal(stats.hits, 1);
+    assert.equal(stats.misses, 1);
+    assert.equal(stats.entries, 1);
+    assert.equal(stats.maxBytes, 1024 * 1024);
+    assert.ok(stats.bytes > 0);
+  });
+
+  it("should freeze cached parse trees", () => {
+    query.enableCache({ maxBytes: 1024 * 1024 });
+    const tree = query.parseSync("select a from t");
+    assert.ok(Object.isFrozen(tree));
+    assert.ok(Object.isFrozen(tree.stmts[0].stmt.SelectStmt.targetList));
+    assert.throws(() => { "use strict"; tree.stmts.push({}); }, TypeError);
+  });
+
+  it("should cache fingerprint, normalize and scan separately", () => {
+    query.enableCache({ maxBytes: 1024 * 1024 });
+    const sql = "select * from users where id = 1";
+    assert.equal(query.fingerprintSync(sql), query.fingerprintSync(sql));
+    assert.equal(query.normalizeSync(sql), query.normalizeSync(sql));
+    assert.equal(query.scanSync(sql), query.scanSync(sql));
+
+    const stats = query.getCacheStats();
+    assert.equal(stats.entries, 3);
+    assert.equal(stats.hits, 3);
+  });
+
+  it("should evict least recently used entries to stay within maxBytes", () => {
+    query.enableCache({ maxBytes: 8192 });
+    for (let i = 0; i < 100; i++) {
+      query.parseSync(`select ${i} from users`);
+    }
+    const stats = query.getCacheStats();
+    assert.ok(stats.bytes <= 8192);
+    assert.ok(stats.evictions > 0);
+    assert.ok(stats.entries < 100);
+  });
+
+  it("should not cache errors", () => {
+    query.enableCache({ maxBytes: 1024 * 1024 });
+    assert.throws(() => query.parseSync("NOT SQL"), query.SqlError);
+    assert.throws(() => query.parseSync("NOT SQL"), query.SqlError);
+    assert.equal(query.getCacheStats().entries, 0);
+  });
+
+  it("should empty on clearCache", () => {
+    query.enableCache({ maxBytes: 1024 * 1024 });
+    query.parseSync("select 1");
+    query.clearCache();
+    assert.equal(query.getCacheStats().entries, 0);
+    assert.equal(query.getCacheStats().bytes, 0);
+  });
+
+  it("should reject an invalid budget", () => {
+    assert.throws(() => query.enableCache({ maxBytes: 0 }));
+  });
+});
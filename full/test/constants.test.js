@@ -0,0 +1,50 @@
+const query = require("../");
+const { describe, it, before } = require('node:test');
+const assert = require('node:assert/strict');
+
+describe("Normalize with constants", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should return the normalized text with constant columns", async () => {
+    const sql = "SELECT * FROM users WHERE id = -5 AND name = 'bob' AND score > 1.5";
+    const result = await query.normalizeWithConstants(sql);
+    assert.equal(result.normalizedQuery, query.normalizeSync(sql));
+    assert.deepEqual(Array.from(result.param), [1, 2, 3]);
+    assert.deepEqual(Array.from(result.location), [31, 45, 63]);
+    assert.deepEqual(Array.from(result.length), [2, 5, 3]);
+    assert.deepEqual([0, 1, 2].map((i) => result.kindName(i)), ["integer", "string", "float"]);
+  });
+
+  it("should slice each constant out of the original text", () => {
+    const sql = "SELECT $1, 'x' /* keep */ , X'1F', 2 FROM t WHERE a IN (3, 4)";
+    const result = query.normalizeWithConstantsSync(sql);
+    const bytes = Buffer.from(sql);
+    const texts = Array.from(result.location, (location, i) =>
+      bytes.subarray(location, location + result.length[i]).toString());
+    assert.deepEqual(texts, ["'x'", "X'1F'", "2", "3", "4"]);
+    assert.deepEqual(Array.from(result.param), [2, 3, 4, 5, 6]);
+    assert.equal(result.kindName(1), "bitstring");
+  });
+
+  it("should use UTF-8 byte offsets", () => {
+    const result = query.normalizeWithConstantsSync("SELECT 'ü', 'é'");
+    assert.deepEqual(Array.from(result.location), [7, 13]);
+    assert.deepEqual(Array.from(result.length), [4, 4]);
+  });
+
+  it("should normalize a batch in input order", async () => {
+    const queries = ["SELECT 1", "SELEC 1", "", "SELECT a FROM t"];
+    const results = await query.normalizeWithConstantsBatch(queries);
+    assert.equal(results[0].normalizedQuery, "SELECT $1");
+    assert.match(results[1].error, /syntax error/);
+    assert.equal(results[2].error, "Query cannot be empty");
+    assert.equal(results[3].normalizedQuery, "SELECT a FROM t");
+    assert.equal(results[3].count, 0);
+  });
+
+  it("should throw for invalid SQL in the single-query form", () => {
+    assert.throws(() => query.normalizeWithConstantsSync("SELECT FROM WHERE"), /syntax error/);
+  });
+});
@@ -64,4 +64,53 @@ describe("Query Fingerprinting", () => {
       );
     });
   });
+
+  describe("64-bit Fingerprints", () => {
+    const queries = [
+      "select 1",
+      "select * from users where id = 1",
+      "select * from users where id = 2",
+      "insert into t (a) values ('x')",
+    ];
+
+    it("should match the hex fingerprint string", () => {
+      for (const sql of queries) {
+        const fp = query.fingerprintBigIntSync(sql);
+        assert.equal(typeof fp, "bigint");
+        assert.equal(fp.toString(16).padStart(16, "0"), query.fingerprintSync(sql));
+      }
+    });
+
+    it("should return a promise resolving to the same fingerprint", async () => {
+      assert.equal(await query.fingerprintBigInt("select 1"), query.fingerprintBigIntSync("select 1"));
+    });
+
+    it("should throw on invalid queries", () => {
+      assert.throws(() => query.fingerprintBigIntSync("NOT A QUERY"), /NOT/);
+      assert.throws(() => query.fingerprintBigIntSync(""), /empty/);
+    });
+
+    it("should fill a caller-provided BigUint64Array", () => {
+      const out = new BigUint64Array(queries.length + 1);
+      const result = query.fingerprintBatchSync(queries, out);
+      assert.equal(result, out);
+      queries.forEach((sql, i) => assert.equal(out[i], query.fingerprintBigIntSync(sql)));
+      assert.equal(out[1], out[2]);
+      assert.equal(out[queries.length], 0n);
+    });
+
+    it("should write 0 for queries that fail", async () => {
+      const out = await query.fingerprintBatch(["select 1", "NOT A QUERY", "", "select\0 1", "select 2"]);
+      assert.equal(out.length, 5);
+      assert.notEqual(out[0], 0n);
+      assert.equal(out[1], 0n);
+      assert.equal(out[2], 0n);
+      assert.equal(out[3], 0n);
+      assert.notEqual(out[4], 0n);
+    });
+
+    it("should reject an output array that is too small", () => {
+      assert.throws(() => query.fingerprintBatchSync(queries, new BigUint64Array(1)), RangeError);
+    });
+  });
 });
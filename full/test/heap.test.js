@@ -0,0 +1,65 @@
+const query = require("../");
+const { describe, it, before, afterEach } = require('node:test');
+const assert = require('node:assert/strict');
+
+const nativeBackend = process.env.LIBPG_QUERY_BACKEND === 'native';
+
+describe("Heap recycling", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  afterEach(() => {
+    query.setRecyclePolicy(null);
+  });
+
+  it("should report heap usage", () => {
+    const stats = query.getHeapStats();
+    assert.ok(stats.usedBytes > 0);
+    assert.ok(stats.memoryBytes >= stats.usedBytes);
+    assert.ok(stats.peakMemoryBytes >= stats.memoryBytes);
+    assert.equal(typeof stats.recycles, "number");
+  });
+
+  it("should release grown memory on recycle", { skip: nativeBackend && "native calls do not grow the WASM heap" }, async () => {
+    const columns = Array.from({ length: 50000 }, (_, i) => `c${i}`).join(", ");
+    query.parseSync(`select ${columns} from t`);
+    const grown = query.getHeapStats();
+
+    await query.recycle();
+
+    const stats = query.getHeapStats();
+    assert.equal(stats.recycles, grown.recycles + 1);
+    assert.ok(stats.memoryBytes < grown.memoryBytes);
+    assert.equal(stats.peakMemoryBytes, grown.peakMemoryBytes);
+    assert.deepEqual(query.parseSync("select 1"), query.parseSync("select 1"));
+  });
+
+  it("should keep serving calls while a recycle is in progress", async () => {
+    const expected = query.fingerprintSync("select * from users");
+    const recycling = Promise.all([query.recycle(), query.recycle()]);
+    const results = await Promise.all([
+      query.fingerprint("select * from users"),
+      query.fingerprint("select * from users"),
+    ]);
+    assert.equal(query.fingerprintSync("select * from users"), expected);
+    await recycling;
+
+    assert.deepEqual(results, [expected, expected]);
+    assert.equal(query.fingerprintSync("select * from users"), expected);
+  });
+
+  it("should recycle automatically past the configured threshold", async () => {
+    const before = query.getHeapStats();
+    query.setRecyclePolicy({ maxMemoryBytes: 1 });
+    query.parseSync("select 1");
+    query.setRecyclePolicy(null);
+    await query.recycle();
+
+    assert.ok(query.getHeapStats().recycles >= before.recycles + 1);
+  });
+
+  it("should reject an invalid threshold", () => {
+    assert.throws(() => query.setRecyclePolicy({ maxMemoryBytes: 0 }), /maxMemoryBytes/);
+  });
+});
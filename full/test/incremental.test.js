@@ -0,0 +1,86 @@
+const query = require("../");
+const { describe, it, before } = require('node:test');
+const assert = require('node:assert/strict');
+
+const SQL = `CREATE TABLE users (id serial PRIMARY KEY, name text);
+INSERT INTO users (name) VALUES ('semi;colon'), ('héllo');
+/* a comment; with a semicolon */
+SELECT * FROM users WHERE name = 'x';
+UPDATE users SET name = 'y' WHERE id = 1;
+SELECT count(*) FROM users`;
+
+function edit(previous, find, deleteLength, insertText) {
+  const offset = previous.sql.indexOf(find);
+  assert.ok(offset >= 0, `"${find}" not found`);
+  return query.reparseSync(previous, { offset, deleteLength, insertText });
+}
+
+describe("Incremental parsing", () => {
+  let initial;
+
+  before(async () => {
+    await query.parse("SELECT 1");
+    initial = { sql: SQL, parseTree: query.parseSync(SQL) };
+  });
+
+  it("should re-parse only the edited statement", () => {
+    const result = edit(initial, "'x'", 3, "'a much longer name'");
+    assert.deepEqual(result.parseTree, query.parseSync(result.sql));
+    assert.equal(result.reparsedStart, 2);
+    assert.equal(result.reparsedCount, 1);
+    assert.strictEqual(result.parseTree.stmts[0], initial.parseTree.stmts[0]);
+  });
+
+  it("should shift the locations of later statements", () => {
+    const result = edit(initial, "CREATE TABLE users", 0, "/* é */ ");
+    assert.deepEqual(result.parseTree, query.parseSync(result.sql));
+    assert.equal(result.reparsedStart, 0);
+    assert.equal(result.reparsedCount, 1);
+  });
+
+  it("should merge statements when a semicolon is deleted", () => {
+    const result = edit(initial, "'x';", 4, "'x' AND true");
+    assert.deepEqual(result.parseTree, query.parseSync(result.sql));
+    assert.equal(result.parseTree.stmts.length, initial.parseTree.stmts.length - 1);
+  });
+
+  it("should split statements when a semicolon is inserted", () => {
+    const result = edit(initial, " WHERE id = 1", 0, "; SELECT 2");
+    assert.deepEqual(result.parseTree, query.parseSync(result.sql));
+    assert.equal(result.parseTree.stmts.length, initial.parseTree.stmts.length + 1);
+  });
+
+  it("should handle an edit that opens a string", () => {
+    const opened = edit(initial, "UPDATE", 0, "SELECT 'open; ");
+    assert.deepEqual(opened.parseTree, query.parseSync(opened.sql));
+    const closed = edit(opened, "'y'", 0, "'");
+    assert.deepEqual(closed.parseTree, query.parseSync(closed.sql));
+  });
+
+  it("should handle edits at the end of the text", () => {
+    let state = initial;
+    for (const ch of "; SELECT 42;") {
+      state = query.reparseSync(state, { offset: state.sql.length, deleteLength: 0, insertText: ch });
+      assert.deepEqual(state.parseTree, query.parseSync(state.sql));
+    }
+  });
+
+  it("should throw the same error as a full parse", () => {
+    let expected;
+    try {
+      query.parseSync(SQL.replace("SET name", "SET SET name"));
+    } catch (error) {
+      expected = error;
+    }
+    assert.ok(expected);
+    assert.throws(() => edit(initial, "SET name", 0, "SET "), (error) => {
+      assert.equal(error.message, expected.message);
+      assert.equal(error.sqlDetails.cursorPosition, expected.sqlDetails.cursorPosition);
+      return true;
+    });
+  });
+
+  it("should reject edits outside the previous text", () => {
+    assert.throws(() => query.reparseSync(initial, { offset: SQL.length, deleteLength: 1, insertText: "" }), RangeError);
+  });
+});
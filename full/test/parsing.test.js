@@ -81,4 +81,53 @@ describe("Query Parsing", () => {
       );
     });
   });
+
+  describe("Batch parsing", () => {
+    it("should parse every query in input order", () => {
+      const queries = ["select 1", "select * from john", "select a, b"];
+      const items = query.parseBatchSync(queries);
+
+      assert.equal(items.length, queries.length);
+      items.forEach((item, i) => {
+        assert.equal(item.error, undefined);
+        assert.deepEqual(item.result, query.parseSync(queries[i]));
+      });
+    });
+
+    it("should report per-query errors without failing the batch", () => {
+      const items = query.parseBatchSync(["select 1", "NOT A QUERY", "", "select 2"]);
+
+      assert.ok(items[0].result);
+      assert.ok(items[1].error instanceof query.SqlError);
+      assert.match(items[1].error.message, /NOT/);
+      assert.ok(items[2].error instanceof Error);
+      assert.ok(items[3].result);
+    });
+
+    it("should return an empty array for an empty batch", () => {
+      assert.deepEqual(query.parseBatchSync([]), []);
+    });
+
+    it("should resolve asynchronously to the same items", async () => {
+      const queries = ["select 1", "select null"];
+      assert.deepEqual(await query.parseBatch(queries), query.parseBatchSync(queries));
+    });
+  });
+
+  describe("Input buffers", () => {
+    it("should parse alternating small and large queries", () => {
+      const columns = Array.from({ length: 10000 }, (_, i) => `c${i}`).join(", ");
+      const large = `select ${columns} from t`;
+
+      for (let i = 0; i < 3; i++) {
+        assert.equal(query.parseSync("select 1").stmts.length, 1);
+        assert.equal(query.parseSync(large).stmts[0].stmt.SelectStmt.targetList.length, 10000);
+      }
+    });
+
+    it("should keep working after a failed parse", () => {
+      assert.throws(() => query.parseSync("select ... from"));
+      assert.equal(query.fingerprintSync("select 1"), query.fingerprintSync("select 2"));
+    });
+  });
 });
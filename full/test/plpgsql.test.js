@@ -72,4 +72,44 @@ describe("PL/pgSQL Parsing", () => {
       );
     });
   });
+
+  describe("Schema dumps", () => {
+    const DUMP = `
+CREATE TABLE users (id serial PRIMARY KEY, name text);
+CREATE FUNCTION one() RETURNS int AS $$ BEGIN RETURN 1; END; $$ LANGUAGE plpgsql;
+CREATE EXTENSION IF NOT EXISTS plpgsql;
+CREATE FUNCTION sq(x int) RETURNS int AS 'SELECT x * x' LANGUAGE sql;
+CREATE PROCEDURE broken() AS $$ BEGIN RETURN 1 +; END; $$ LANGUAGE plpgsql;
+CREATE FUNCTION héllo() RETURNS text AS $$ BEGIN RETURN 'ü'; END; $$ LANGUAGE plpgsql;
+`;
+
+    it("should find and parse every PL/pgSQL function in one call", async () => {
+      const functions = await query.parsePlPgSQLDump(DUMP);
+      assert.equal(functions.length, 3);
+
+      const bytes = Buffer.from(DUMP);
+      for (const fn of functions) {
+        assert.equal(bytes.subarray(fn.location, fn.location + fn.length).toString(), fn.sql);
+      }
+
+      assert.match(functions[0].sql, /^CREATE FUNCTION one\(\)/);
+      assert.deepEqual(functions[0].parseTree, query.parsePlPgSQLSync(functions[0].sql));
+      assert.match(functions[1].sql, /^CREATE PROCEDURE broken/);
+      assert.equal(functions[1].parseTree, undefined);
+      assert.match(functions[1].error.message, /syntax error/);
+      assert.equal(functions[2].parseTree.plpgsql_funcs.length, 1);
+    });
+
+    it("should stream the same functions", async () => {
+      const chunks = [];
+      for (let i = 0; i < DUMP.length; i += 17) {
+        chunks.push(DUMP.slice(i, i + 17));
+      }
+      const streamed = [];
+      for await (const fn of query.parsePlPgSQLStream(chunks)) {
+        streamed.push(fn);
+      }
+      assert.deepEqual(streamed, query.parsePlPgSQLDumpSync(DUMP));
+    });
+  });
 });
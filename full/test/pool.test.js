@@ -0,0 +1,184 @@
+const query = require("../");
+const { describe, it, before, after } = require('node:test');
+const assert = require('node:assert/strict');
+
+describe("Parser Pool", () => {
+  let pool;
+
+  before(async () => {
+    await query.parse("SELECT 1");
+    pool = new query.ParserPool({ size: 2 });
+  });
+
+  after(async () => {
+    await pool.destroy();
+  });
+
+  it("should parse on worker threads with the same result", async () => {
+    const testQuery = "select * from john where id = 1";
+    assert.deepEqual(await pool.parse(testQuery), query.parseSync(testQuery));
+  });
+
+  it("should spread many calls across workers", async () => {
+    const queries = Array.from({ length: 20 }, (_, i) => `select ${i}`);
+    const results = await Promise.all(queries.map((q) => pool.parse(q)));
+    results.forEach((res, i) => {
+      assert.deepEqual(res, query.parseSync(queries[i]));
+    });
+  });
+
+  it("should run the other operations", async () => {
+    const sql = "select * from users where id = 123";
+    assert.equal(await pool.fingerprint(sql), query.fingerprintSync(sql));
+    assert.equal(await pool.normalize(sql), query.normalizeSync(sql));
+    assert.deepEqual(await pool.scan(sql), query.scanSync(sql));
+    assert.equal(await pool.deparse(query.parseSync(sql)), query.deparseSync(query.parseSync(sql)));
+  });
+
+  it("should reject with a SqlError on bogus queries", async () => {
+    await assert.rejects(pool.parse("NOT A QUERY"), (err) => {
+      assert.ok(err instanceof query.SqlError);
+      assert.match(err.message, /NOT/);
+      assert.equal(typeof err.sqlDetails.cursorPosition, "number");
+      return true;
+    });
+  });
+
+  it("should hand out the compiled module for reuse in workers", async () => {
+    const { Worker } = require('node:worker_threads');
+    const wasmModule = await query.getCompiledModule();
+    assert.ok(wasmModule instanceof WebAssembly.Module);
+
+    const worker = new Worker(`
+      const { parentPort, workerData } = require('node:worker_threads');
+      const query = require(workerData.entry);
+      query.loadModule({ wasmModule: workerData.wasmModule })
+        .then(() => parentPort.postMessage(query.fingerprintSync('select 1')));
+    `, { eval: true, workerData: { entry: require.resolve("../"), wasmModule } });
+    const [fingerprint] = await require('node:events').once(worker, 'message');
+    await worker.terminate();
+
+    assert.equal(fingerprint, query.fingerprintSync('select 1'));
+  });
+
+  it("should reject a call that times out and keep serving", async () => {
+    const sql = Array.from({ length: 20000 }, (_, i) => `select ${i}`).join(" union ");
+    await assert.rejects(pool.parse(sql, { timeout: 1 }), { name: "TimeoutError" });
+    assert.equal(await pool.fingerprint("select 1"), query.fingerprintSync("select 1"));
+  });
+
+  it("should reject aborted calls", async () => {
+    const controller = new AbortController();
+    const pending = pool.normalize("select 1", { signal: controller.signal });
+    controller.abort();
+    await assert.rejects(pending, { name: "AbortError" });
+    await assert.rejects(pool.normalize("select 1", { signal: controller.signal }), { name: "AbortError" });
+  });
+
+  it("should drop a queued call without disturbing the running one", async () => {
+    const single = new query.ParserPool({ size: 1 });
+    try {
+      const sql = Array.from({ length: 2000 }, (_, i) => `select ${i}`).join(" union ");
+      const running = single.fingerprint(sql);
+      const controller = new AbortController();
+      const queued = single.normalize("select 1", { signal: controller.signal });
+      controller.abort();
+      await assert.rejects(queued, { name: "AbortError" });
+      assert.equal(await running, query.fingerprintSync(sql));
+    } finally {
+      await single.destroy();
+    }
+  });
+
+  it("should reject calls after destroy", async () => {
+    const temp = new query.ParserPool({ size: 1 });
+    await temp.destroy();
+    await assert.rejects(temp.parse("select 1"), /destroyed/);
+  });
+});
+
+// Which calls went to a worker, from the stats samples they record
+async function backgroundCalls(run) {
+  const samples = [];
+  query.enableStats({ onCall: (sample) => samples.push(sample) });
+  try {
+    await run();
+  } finally {
+    query.disableStats();
+  }
+  return samples.filter((sample) => sample.background).map((sample) => sample.operation);
+}
+
+describe("Background async calls", () => {
+  const large = Array.from({ length: 200 }, (_, i) => `select ${i} from t${i}`).join(" union ");
+
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should default to a worker pool in Node.js", async () => {
+    const background = await backgroundCalls(async () => {
+      assert.deepEqual(await query.parse(large), query.parseSync(large));
+    });
+    assert.deepEqual(background, ["parse"]);
+  });
+});
+
+describe("Configured background async calls", () => {
+  const large = Array.from({ length: 200 }, (_, i) => `select ${i} from t${i}`).join(" union ");
+
+  before(async () => {
+    await query.configureAsync({ workers: 1, inlineBelowLength: 1024 });
+  });
+
+  after(async () => {
+    // Back to the default pool size
+    await query.configureAsync({ workers: undefined, inlineBelowLength: 1024 });
+  });
+
+  it("should return the same results as the sync functions", async () => {
+    assert.deepEqual(await query.parse(large), query.parseSync(large));
+    assert.equal(await query.fingerprint(large), query.fingerprintSync(large));
+    assert.equal(await query.normalize(large), query.normalizeSync(large));
+    const tree = query.parseSync("select a from b");
+    assert.equal(await query.deparse(tree), query.deparseSync(tree));
+  });
+
+  it("should keep the event loop responsive during a large parse", async () => {
+    const huge = Array.from({ length: 20000 }, (_, i) => `select ${i}`).join(" union ");
+    let ticks = 0;
+    const interval = setInterval(() => ticks++, 1);
+    const started = Date.now();
+    await query.parse(huge);
+    clearInterval(interval);
+    assert.ok(ticks > 0 || Date.now() - started < 5);
+  });
+
+  it("should support timeouts and abort signals", async () => {
+    const huge = Array.from({ length: 20000 }, (_, i) => `select ${i}`).join(" union ");
+    await assert.rejects(query.parse(huge, { timeout: 1 }), { name: "TimeoutError" });
+    const controller = new AbortController();
+    controller.abort();
+    await assert.rejects(query.parse("select 1", { signal: controller.signal }), { name: "AbortError" });
+  });
+
+  it("should send short calls with a timeout or signal to a worker", async () => {
+    const background = await backgroundCalls(async () => {
+      assert.deepEqual(await query.parse("select 1", { timeout: 60000 }), query.parseSync("select 1"));
+      assert.equal(await query.fingerprint("select 1", { signal: new AbortController().signal }), query.fingerprintSync("select 1"));
+    });
+    assert.deepEqual(background, ["parse", "fingerprint"]);
+  });
+
+  it("should run on the calling thread when workers is 0", async () => {
+    await query.configureAsync({ workers: 0 });
+    assert.deepEqual(await query.parse(large), query.parseSync(large));
+    await assert.rejects(query.parse("NOT A QUERY".padEnd(2000, " ")), query.SqlError);
+  });
+
+  it("should reject a timeout or signal when workers is 0", async () => {
+    await query.configureAsync({ workers: 0 });
+    await assert.rejects(query.parse("select 1", { timeout: 60000 }), /signal and timeout need a worker thread/);
+    await assert.rejects(query.normalize("select 1", { signal: new AbortController().signal }), /signal and timeout need a worker thread/);
+  });
+});
@@ -0,0 +1,126 @@
+const query = require("../");
+const { describe, it, before } = require('node:test');
+const assert = require('node:assert/strict');
+
+const QUERIES = [
+  "select 1",
+  "select null",
+  "select -1, -2147483648, 1.5e10, 'abc', B'101', true",
+  "select a.id, b.name from users a join orders b on a.id = b.user_id where a.id > $1 order by 2 desc limit 10",
+  "insert into t (a, b) values (1, 'x') on conflict (a) do update set b = excluded.b returning *",
+  "create table t (id serial primary key, name text not null default '', data jsonb)",
+  "with recursive r(n) as (select 1 union all select n + 1 from r where n < 10) select * from r",
+  "select '日本語', count(*) filter (where x) over (partition by y) from z",
+  "select 1; select 2; update t set a = 1",
+];
+
+describe("Protobuf Parsing", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should return the parse tree as protobuf bytes", () => {
+    const buffer = query.parseProtobufSync("select 1");
+    assert.ok(buffer instanceof Uint8Array);
+    assert.ok(buffer.length > 0);
+  });
+
+  it("should return a promise resolving to protobuf bytes", async () => {
+    const buffer = await query.parseProtobuf("select 1");
+    assert.ok(buffer instanceof Uint8Array);
+  });
+
+  it("should decode to the same tree as parseSync", () => {
+    for (const sql of QUERIES) {
+      const decoded = query.decodeParseResult(query.parseProtobufSync(sql));
+      assert.deepEqual(decoded, query.parseSync(sql), sql);
+    }
+  });
+
+  it("should decode an empty statement list", () => {
+    const decoded = query.decodeParseResult(query.parseProtobufSync("-- comment"));
+    assert.deepEqual(decoded, query.parseSync("-- comment"));
+  });
+
+  it("should throw SqlError on invalid queries", () => {
+    assert.throws(() => query.parseProtobufSync("CREATE RANDOM ?"), (error) => {
+      assert.ok(error instanceof query.SqlError);
+      assert.ok(error.sqlDetails);
+      return true;
+    });
+  });
+
+  it("should reject non-buffer input to decodeParseResult", () => {
+    assert.throws(() => query.decodeParseResult("select 1"), TypeError);
+  });
+});
+
+describe("Protobuf Encoding", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should encode to bytes that decode back to the same tree", () => {
+    for (const sql of QUERIES) {
+      const tree = query.parseSync(sql);
+      assert.deepEqual(query.decodeParseResult(query.encodeParseResult(tree)), tree, sql);
+    }
+  });
+
+  it("should decode the parser's own encoding after re-encoding", () => {
+    for (const sql of QUERIES) {
+      const tree = query.decodeParseResult(query.parseProtobufSync(sql));
+      assert.deepEqual(query.decodeParseResult(query.encodeParseResult(tree)), tree, sql);
+    }
+  });
+
+  it("should accept enum values as numbers", () => {
+    const tree = query.parseSync("select 1 union select 2");
+    tree.stmts[0].stmt.SelectStmt.op = 2;
+    assert.equal(query.deparseSync(tree), "SELECT 1 UNION SELECT 2");
+  });
+
+  it("should reject malformed trees", () => {
+    assert.throws(() => query.encodeParseResult({ version: 1, stmts: [{ stmt: 5 }] }), TypeError);
+  });
+});
+
+describe("Lazy Parsing", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should produce the same tree as parseSync", () => {
+    for (const sql of QUERIES) {
+      assert.deepEqual(query.parseLazySync(sql), query.parseSync(sql), sql);
+    }
+  });
+
+  it("should return a promise resolving to the lazy tree", async () => {
+    const tree = await query.parseLazy("select 1");
+    assert.equal(tree.stmts.length, 1);
+  });
+
+  it("should decode fields on first access only", () => {
+    const tree = query.parseLazySync("select a from users");
+    const descriptor = Object.getOwnPropertyDescriptor(tree, "stmts");
+    assert.equal(typeof descriptor.get, "function");
+
+    const stmts = tree.stmts;
+    assert.ok(Object.getOwnPropertyDescriptor(tree, "stmts").value === stmts);
+    assert.equal(tree.stmts, stmts);
+    assert.deepEqual(Object.keys(stmts[0].stmt), ["SelectStmt"]);
+    assert.equal(stmts[0].stmt.SelectStmt.fromClause[0].RangeVar.relname, "users");
+  });
+
+  it("should allow fields to be overwritten", () => {
+    const tree = query.parseLazySync("select a from users");
+    tree.stmts[0].stmt.SelectStmt.fromClause[0].RangeVar.relname = "orders";
+    assert.equal(query.deparseSync(tree), "SELECT a FROM orders");
+  });
+
+  it("should serialize like the eager tree", () => {
+    const sql = "select * from t where x in (1, 2, 3)";
+    assert.equal(JSON.stringify(query.parseLazySync(sql)), JSON.stringify(query.decodeParseResult(query.parseProtobufSync(sql))));
+  });
+});
@@ -0,0 +1,75 @@
+const query = require("../");
+const { describe, it, before } = require('node:test');
+const assert = require('node:assert/strict');
+
+describe("Reference extraction", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should list relations with schema, alias and access", async () => {
+    const sql = "WITH recent AS (SELECT * FROM app.orders o) DELETE FROM carts USING recent WHERE now() > recent.ts";
+    assert.deepEqual(await query.extractReferences(sql), {
+      statements: [{ type: "DeleteStmt", location: 0, length: 98 }],
+      relations: [
+        { schema: "app", relation: "orders", alias: "o", access: "select", location: 30, statement: 0 },
+        { relation: "carts", access: "delete", location: 56, statement: 0 }
+      ],
+      functions: [{ name: "now", location: 81, statement: 0 }]
+    });
+  });
+
+  it("should agree with the parse tree on relation names", () => {
+    const sql = "INSERT INTO audit SELECT u.id, lower(u.name) FROM users u JOIN (SELECT * FROM s.roles) r ON r.id = u.role WHERE EXISTS (SELECT 1 FROM bans b WHERE b.id = u.id)";
+    const names = [];
+    const walk = (node) => {
+      if (Array.isArray(node)) {
+        node.forEach(walk);
+      } else if (node && typeof node === "object") {
+        if (node.RangeVar) {
+          names.push(node.RangeVar.relname);
+        }
+        Object.values(node).forEach(walk);
+      }
+    };
+    walk(query.parseSync(sql));
+
+    const references = query.extractReferencesSync(sql);
+    assert.deepEqual(references.relations.map((r) => r.relation).sort(), names.sort());
+    assert.deepEqual(references.relations.map((r) => r.access), ["insert", "select", "select", "select"]);
+    assert.deepEqual(references.functions.map((f) => f.name), ["lower"]);
+  });
+
+  it("should number statements and report utility statements", () => {
+    const references = query.extractReferencesSync(
+      "BEGIN; UPDATE a SET x = 1; DROP TABLE s.b, c; TRUNCATE d; CREATE TABLE e (id int REFERENCES f)"
+    );
+    assert.deepEqual(references.statements.map((s) => s.type),
+      ["TransactionStmt", "UpdateStmt", "DropStmt", "TruncateStmt", "CreateStmt"]);
+    assert.deepEqual(
+      references.relations.map((r) => [r.schema, r.relation, r.access, r.statement]),
+      [
+        [undefined, "a", "update", 1],
+        ["s", "b", "drop", 2],
+        [undefined, "c", "drop", 2],
+        [undefined, "d", "truncate", 3],
+        [undefined, "e", "create", 4],
+        [undefined, "f", "other", 4]
+      ]
+    );
+    assert.equal(references.relations[1].location, -1);
+  });
+
+  it("should keep tables shadowed only by later CTEs", () => {
+    const references = query.extractReferencesSync(
+      "WITH t AS (SELECT * FROM t) SELECT * FROM t"
+    );
+    assert.deepEqual(references.relations.map((r) => r.relation), ["t"]);
+    assert.equal(references.relations[0].location, 25);
+  });
+
+  it("should throw on invalid SQL", () => {
+    assert.throws(() => query.extractReferencesSync("SELECT * FROM"), /syntax error/);
+    assert.throws(() => query.extractReferencesSync(""), /empty/);
+  });
+});
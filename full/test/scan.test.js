@@ -226,4 +226,97 @@ describe("Query Scanning", () => {
       assert.ok(result1.version > 0);
     });
   });
-});
\ No newline at end of file
+
+  describe("Binary Scanning", () => {
+    const queries = [
+      "SELECT * FROM users WHERE id = $1",
+      "select 'it''s', \"Quoted\"\"Ident\", 1.5e3::numeric -- trailing",
+      "SELECT 'café', 名前 FROM t /* comment */",
+    ];
+
+    it("should match the JSON scan token for token", () => {
+      for (const sql of queries) {
+        const json = query.scanSync(sql);
+        const binary = query.scanBinarySync(sql);
+        assert.equal(binary.version, json.version);
+        assert.equal(binary.count, json.tokens.length);
+        json.tokens.forEach((token, i) => {
+          assert.equal(binary.start[i], token.start);
+          assert.equal(binary.end[i], token.end);
+          assert.equal(binary.tokenType[i], token.tokenType);
+          assert.equal(binary.keywordKind[i], token.keywordKind);
+          assert.equal(binary.keywordName(i), token.keywordName);
+          assert.equal(binary.text(i), token.text);
+        });
+      }
+    });
+
+    it("should return typed array columns", async () => {
+      const result = await query.scanBinary("SELECT a FROM b");
+      assert.ok(result.start instanceof Int32Array);
+      assert.ok(result.tokenType instanceof Int32Array);
+      assert.equal(result.count, 4);
+      assert.equal(result.text(0), "SELECT");
+      assert.equal(result.tokenName(0), "SELECT");
+      assert.equal(result.keywordName(0), "RESERVED_KEYWORD");
+      assert.equal(result.tokenName(1), "IDENT");
+    });
+
+    it("should include comment tokens", () => {
+      const result = query.scanBinarySync("-- only a comment");
+      assert.equal(result.count, 1);
+      assert.equal(result.tokenName(0), "SQL_COMMENT");
+    });
+
+    it("should throw on unterminated input", () => {
+      assert.throws(() => query.scanBinarySync("SELECT 'unterminated"), Error);
+    });
+  });
+
+  describe("Fast Scanning", () => {
+    const long = "x".repeat(300);
+    const queries = [
+      "SELECT * FROM users WHERE id = $1",
+      "select 'it''s', \"Quoted\"\"Ident\", 1.5e3::numeric -- trailing",
+      "SELECT 'café', 名前 FROM t /* comment */",
+      "select a, b_2, 123456789, 1234567890 from tbl_name where (c = 1) and d[2] > 0;",
+      `SELECT '${long}' AS long_string, $$${long}$$ -- ${long}\nFROM t`,
+      "SELECT 'first'     \n   'continued' AS s, E'\\n', U&'d\\0061t\\+000061', x'1F', b'01'",
+      "INSERT INTO t (a) VALUES (1), (2); UPDATE t SET a = a + 1 RETURNING *;",
+      "   \t\n  ",
+    ];
+
+    it("should return the same tokens as scanBinary", () => {
+      for (const sql of queries) {
+        const binary = query.scanBinarySync(sql);
+        const fast = query.scanFastSync(sql);
+        assert.equal(fast.version, binary.version);
+        assert.deepEqual(Array.from(fast.start), Array.from(binary.start), sql);
+        assert.deepEqual(Array.from(fast.end), Array.from(binary.end), sql);
+        assert.deepEqual(Array.from(fast.tokenType), Array.from(binary.tokenType), sql);
+        assert.deepEqual(Array.from(fast.keywordKind), Array.from(binary.keywordKind), sql);
+      }
+    });
+
+    it("should match scanBinary on long generated input", async () => {
+      const sql = Array.from({ length: 200 }, (_, i) => queries[i % 7]).join("\n");
+      const binary = query.scanBinarySync(sql);
+      const fast = await query.scanFast(sql);
+      assert.equal(fast.count, binary.count);
+      assert.deepEqual(Array.from(fast.tokenType), Array.from(binary.tokenType));
+      assert.deepEqual(Array.from(fast.end), Array.from(binary.end));
+    });
+
+    it("should throw like scanBinary on unterminated input", () => {
+      const sql = "SELECT a, b FROM t WHERE c = 'unterminated";
+      let expected;
+      try {
+        query.scanBinarySync(sql);
+      } catch (error) {
+        expected = error.message;
+      }
+      assert.ok(expected);
+      assert.throws(() => query.scanFastSync(sql), { message: expected });
+    });
+  });
+});
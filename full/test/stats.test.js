@@ -0,0 +1,108 @@
+const query = require("../");
+const { describe, it, before, afterEach } = require('node:test');
+const assert = require('node:assert/strict');
+
+const nativeBackend = process.env.LIBPG_QUERY_BACKEND === 'native';
+
+describe("Call stats", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  afterEach(() => {
+    query.disableStats();
+  });
+
+  it("should return null while disabled", () => {
+    query.parseSync("select 1");
+    assert.equal(query.getStats(), null);
+  });
+
+  it("should count calls, bytes and timings per operation", () => {
+    query.enableStats();
+    query.parseSync("select 1");
+    query.parseSync("select * from users");
+    query.fingerprintSync("select 1");
+
+    const stats = query.getStats();
+    const parse = stats.operations.parse;
+    assert.equal(parse.calls, 2);
+    assert.equal(parse.errors, 0);
+    assert.equal(parse.bytesIn, "select 1".length + "select * from users".length);
+    assert.ok(parse.bytesOut > 0);
+    for (const histogram of [parse.totalMs, parse.marshalMs, parse.wasmMs, parse.decodeMs]) {
+      assert.equal(histogram.count, 2);
+      assert.equal(histogram.buckets.length, stats.bucketsMs.length);
+      assert.equal(histogram.buckets[histogram.buckets.length - 1], 2);
+    }
+    assert.ok(parse.wasmMs.sum > 0);
+    assert.ok(parse.wasmMs.sum <= parse.totalMs.sum);
+    assert.equal(stats.operations.fingerprint.calls, 1);
+  });
+
+  it("should count errors", () => {
+    query.enableStats();
+    assert.throws(() => query.parseSync("select from where"));
+    assert.throws(() => query.scanBinarySync("select 'unterminated"));
+
+    const { operations } = query.getStats();
+    assert.equal(operations.parse.calls, 1);
+    assert.equal(operations.parse.errors, 1);
+    assert.equal(operations.scanBinary.errors, 1);
+  });
+
+  it("should report every call to the callback", () => {
+    const samples = [];
+    query.enableStats({
+      onCall: (sample) => {
+        samples.push(sample);
+        throw new Error("ignored");
+      },
+    });
+    const tree = query.parseSync("select 1");
+    query.deparseSync(tree);
+    query.analyzeSync("select 1");
+
+    assert.deepEqual(samples.map((sample) => sample.operation), ["parse", "deparse", "analyze"]);
+    for (const sample of samples) {
+      assert.equal(sample.error, false);
+      assert.equal(sample.background, false);
+      assert.ok(sample.totalMs >= sample.marshalMs + sample.decodeMs);
+      assert.ok(sample.bytesIn > 0);
+    }
+  });
+
+  it("should count linear memory growth", { skip: nativeBackend && "native calls do not grow the WASM heap" }, () => {
+    query.enableStats();
+    const columns = Array.from({ length: 50000 }, (_, i) => `c${i}`).join(", ");
+    query.parseSync(`select ${columns} from t`);
+
+    const stats = query.getStats();
+    assert.equal(stats.operations.parse.heapGrowths, 1);
+    assert.equal(stats.memoryBytes, query.getHeapStats().memoryBytes);
+  });
+
+  it("should not count cache hits", () => {
+    query.enableCache({ maxBytes: 1024 * 1024 });
+    try {
+      query.enableStats();
+      query.normalizeSync("select 1");
+      query.normalizeSync("select 1");
+      assert.equal(query.getStats().operations.normalize.calls, 1);
+    } finally {
+      query.disableCache();
+    }
+  });
+
+  it("should return snapshots and reset", () => {
+    query.enableStats();
+    query.scanSync("select 1");
+    const snapshot = query.getStats();
+    query.scanSync("select 1");
+
+    assert.equal(snapshot.operations.scan.calls, 1);
+    assert.equal(query.getStats().operations.scan.calls, 2);
+    query.resetStats();
+    assert.deepEqual(query.getStats().operations, {});
+  });
+});
@@ -0,0 +1,124 @@
+const query = require("../");
+const { describe, it, before } = require('node:test');
+const assert = require('node:assert/strict');
+const { Readable } = require('node:stream');
+
+const DUMP = `
+CREATE TABLE users (id serial PRIMARY KEY, name text);
+INSERT INTO users (name) VALUES ('semi;colon'), ('héllo');
+/* a comment; with a semicolon */
+CREATE FUNCTION f() RETURNS int AS $$ BEGIN RETURN 1; END; $$ LANGUAGE plpgsql;
+SELECT * FROM users WHERE name = 'x'
+`;
+
+const COPY_DUMP = `
+CREATE TABLE notes (id int, body text);
+COPY public.notes (id, body) FROM stdin;
+1\tit's; not sql
+2\t\\. still data
+\\.
+SELECT 1;
+COPY notes FROM stdin;
+\\.
+SELECT 2;
+`;
+
+async function collect(iterable) {
+  const items = [];
+  for await (const item of iterable) {
+    items.push(item);
+  }
+  return items;
+}
+
+function chunked(text, size) {
+  const bytes = Buffer.from(text);
+  const chunks = [];
+  for (let i = 0; i < bytes.length; i += size) {
+    chunks.push(bytes.subarray(i, i + size));
+  }
+  return chunks;
+}
+
+describe("Streaming", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should split a stream into statements with byte offsets", async () => {
+    const statements = await collect(query.splitStatementsStream([DUMP]));
+    assert.equal(statements.length, 4);
+
+    const bytes = Buffer.from(DUMP);
+    for (const statement of statements) {
+      assert.equal(bytes.subarray(statement.location, statement.location + statement.length).toString(), statement.sql);
+    }
+    assert.match(statements[3].sql, /SELECT \* FROM users/);
+  });
+
+  it("should give the same statements for any chunk size", async () => {
+    const expected = await collect(query.splitStatementsStream([DUMP]));
+    for (const size of [1, 2, 3, 7, 16, 64]) {
+      const statements = await collect(query.splitStatementsStream(chunked(DUMP, size)));
+      assert.deepEqual(statements, expected, `chunk size ${size}`);
+    }
+  });
+
+  it("should accept a Node Readable", async () => {
+    const statements = await collect(query.splitStatementsStream(Readable.from(chunked(DUMP, 10))));
+    assert.equal(statements.length, 4);
+  });
+
+  it("should parse each statement as it is split", async () => {
+    const parsed = await collect(query.parseStream(chunked(DUMP, 5)));
+    assert.equal(parsed.length, 4);
+    assert.ok(parsed[0].parseTree.stmts[0].stmt.CreateStmt);
+    assert.ok(parsed[1].parseTree.stmts[0].stmt.InsertStmt);
+    assert.ok(parsed[2].parseTree.stmts[0].stmt.CreateFunctionStmt);
+    assert.ok(parsed[3].parseTree.stmts[0].stmt.SelectStmt);
+  });
+
+  it("should ignore trailing whitespace and empty input", async () => {
+    assert.deepEqual(await collect(query.splitStatementsStream([])), []);
+    assert.deepEqual(await collect(query.splitStatementsStream(["  \n", "\n"])), []);
+    assert.equal((await collect(query.splitStatementsStream(["select 1;", "\n\n"]))).length, 1);
+  });
+
+  it("should throw on input that never becomes valid", async () => {
+    await assert.rejects(collect(query.splitStatementsStream(["select 1; select 'unterminated"])));
+  });
+
+  it("should skip COPY ... FROM stdin data", async () => {
+    for (const size of [1, 3, 16, 1024]) {
+      const statements = await collect(query.splitStatementsStream(chunked(COPY_DUMP, size)));
+      assert.deepEqual(statements.map((statement) => statement.sql.trim()), [
+        'CREATE TABLE notes (id int, body text)',
+        'COPY public.notes (id, body) FROM stdin',
+        'SELECT 1',
+        'COPY notes FROM stdin',
+        'SELECT 2'
+      ], `chunk size ${size}`);
+
+      const bytes = Buffer.from(COPY_DUMP);
+      for (const statement of statements) {
+        assert.equal(bytes.subarray(statement.location, statement.location + statement.length).toString(), statement.sql);
+      }
+    }
+  });
+
+  it("should throw once a statement outgrows maxStatementBytes", async () => {
+    const chunks = ["select 1;", " select 'unterminated;", ...Array(100).fill("more;")];
+    await assert.rejects(
+      collect(query.splitStatementsStream(chunks, { maxStatementBytes: 256 })),
+      /maxStatementBytes \(256\) of byte 9/
+    );
+
+    const long = `select '${'x;'.repeat(1000)}';`;
+    const statements = await collect(query.splitStatementsStream(chunked(long, 10), { maxStatementBytes: 4096 }));
+    assert.equal(statements.length, 1);
+  });
+
+  it("should surface parse errors for individual statements", async () => {
+    await assert.rejects(collect(query.parseStream(["select 1; selec 2;"])), query.SqlError);
+  });
+});
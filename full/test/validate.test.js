@@ -0,0 +1,68 @@
+const query = require("../");
+const { describe, it, before } = require('node:test');
+const assert = require('node:assert/strict');
+
+describe("Validation", () => {
+  before(async () => {
+    await query.parse("SELECT 1");
+  });
+
+  it("should accept valid SQL", async () => {
+    assert.deepEqual(await query.validate("SELECT * FROM users WHERE id = 1"), { valid: true });
+    assert.deepEqual(query.validateSync("CREATE TABLE t (id int); INSERT INTO t VALUES (1)"), { valid: true });
+  });
+
+  it("should report the error position without throwing", () => {
+    const sql = "SELECT * FROM users WHERE id = @";
+    const result = query.validateSync(sql);
+    assert.equal(result.valid, false);
+
+    let error;
+    try {
+      query.parseSync(sql);
+    } catch (e) {
+      error = e;
+    }
+    assert.equal(result.error.message, error.sqlDetails.message);
+    assert.equal(result.error.cursorPosition, error.sqlDetails.cursorPosition);
+  });
+
+  it("should validate a batch in input order", async () => {
+    const results = await query.validateBatch(["SELECT 1", "SELEC 1", "", "SELECT 2", "SELECT 'a\0b'"]);
+    assert.deepEqual(results.map((result) => result.valid), [true, false, false, true, false]);
+    assert.match(results[1].error.message, /syntax error/);
+    assert.equal(results[1].error.cursorPosition, 0);
+    assert.equal(results[2].error.message, "Query cannot be empty");
+    assert.match(results[4].error.message, /NUL/);
+  });
+
+  it("should agree with parse", () => {
+    const queries = [
+      "SELECT 1",
+      "SELECT FROM",
+      "SELECT * FROM t WHERE",
+      "UPDATE t SET a = 1 WHERE b = 2",
+      "SELECT 'unterminated",
+      "SELECT ü FROM t WHERE x = @",
+    ];
+    const results = query.validateBatchSync(queries);
+    queries.forEach((sql, i) => {
+      let details;
+      try {
+        query.parseSync(sql);
+      } catch (error) {
+        details = error.sqlDetails;
+      }
+      assert.equal(results[i].valid, !details, sql);
+      if (details) {
+        assert.equal(results[i].error.cursorPosition, details.cursorPosition, sql);
+      }
+    });
+  });
+
+  it("should reject non-string input", () => {
+    assert.throws(() => query.validateSync(null), TypeError);
+    assert.throws(() => query.validateBatchSync("SELECT 1"), TypeError);
+    assert.throws(() => query.validateBatchSync(["SELECT 1", 2]), /index 1/);
+  });
+});
@@ -0,0 +1,61 @@
+// Loader for the combined multi-version binary (see Makefile), copied into
+// @pgsql/parser as wasm/combined/loader.cjs by scripts/prepare.js. Each
+// version's libpg-query.js is replaced there by forVersion(<version>), so the
+// version modules load unchanged and every version on a thread runs on one
+// instance of the binary.
+const path = require('path');
+
+// Entry points the binary exports once per version, as _wasm_v<version>_*
+const FUNCTIONS = ['parse_query_raw', 'free_parse_result', 'parse_batch', 'free_parse_batch'];
+
+let compiled = null;
+let instance = null;
+
+// Compiled once for all versions; null outside Node, where Emscripten fetches
+// the binary itself
+function compileWasm() {
+  if (typeof process === 'undefined' || !process.versions?.node) {
+    return Promise.resolve(null);
+  }
+  if (!compiled) {
+    compiled = require('fs').promises.readFile(path.join(__dirname, 'libpg-query.wasm')).then((bytes) => WebAssembly.compile(bytes));
+    compiled.catch(() => {
+      compiled = null;
+    });
+  }
+  return compiled;
+}
+
+// Instantiated with the options of the first version module to load, such as
+// its instantiateWasm hook for an already compiled binary
+function getInstance(options) {
+  if (!instance) {
+    instance = require('./libpg-query.js')(options);
+    // Let a failed load be retried
+    instance.catch(() => {
+      instance = null;
+    });
+  }
+  return instance;
+}
+
+// Stands in for one version's Emscripten loader: the instance, with that
+// version's entry points under the names its module calls, and everything else,
+// the heap included, shared with the other versions
+function forVersion(version) {
+  const load = (options) => getInstance(options).then((module) => {
+    const view = Object.create(module);
+    for (const name of FUNCTIONS) {
+      const fn = module[`_wasm_v${version}_${name}`];
+      if (typeof fn !== 'function') {
+        throw new Error(`The combined binary does not include PostgreSQL ${version}`);
+      }
+      view[`_wasm_${name}`] = fn;
+    }
+    return view;
+  });
+  load.compileWasm = compileWasm;
+  return load;
+}
+
+module.exports = { forVersion };
@@ -0,0 +1,42 @@
+// Prints a header that renames every external symbol a libpg_query archive
+// defines to <prefix><symbol>, for the combined multi-version build (see
+// ../combined/Makefile):
+//
+//   node prefix-symbols.js <nm> <libpg_query.a> <prefix> > prefix.h
+const { execFileSync } = require('child_process');
+const path = require('path');
+
+// Vendored libraries every version links in unchanged: left alone, they are
+// linked once for all versions
+const SHARED_PREFIXES = ['protobuf_c_', 'XXH'];
+
+const [nm, archive, prefix] = process.argv.slice(2);
+if (!nm || !archive || !prefix) {
+  console.error('Usage: node prefix-symbols.js <nm> <archive> <prefix>');
+  process.exit(1);
+}
+
+const output = execFileSync(nm, ['--defined-only', '--extern-only', '-j', archive], {
+  encoding: 'utf8',
+  maxBuffer: 64 * 1024 * 1024
+});
+
+// nm also prints a "member.o:" line and a blank line per archive member
+const symbols = new Set();
+for (const line of output.split('\n')) {
+  const symbol = line.trim();
+  if (/^[A-Za-z_][A-Za-z0-9_]*$/.test(symbol) && !SHARED_PREFIXES.some((shared) => symbol.startsWith(shared))) {
+    symbols.add(symbol);
+  }
+}
+
+if (symbols.size === 0) {
+  console.error(`No symbols found in ${archive}`);
+  process.exit(1);
+}
+
+const lines = [`// Generated by parser/scripts/prefix-symbols.js from ${path.basename(archive)}`];
+for (const symbol of [...symbols].sort()) {
+  lines.push(`#define ${symbol} ${prefix}${symbol}`);
+}
+process.stdout.write(lines.join('\n') + '\n');
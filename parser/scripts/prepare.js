@@ -24,9 +24,31 @@ if (!config) {
   process.exit(1);
 }
 
+// PARSER_COMBINED=1 ships the combined binary from ../combined (build it with
+// `npm run combined:build`) in place of the per-version libpg-query.wasm files
+const combined = process.env.PARSER_COMBINED === '1';
+const combinedWasmDir = path.join(__dirname, '../combined/wasm');
+
+if (combined) {
+  const versionsFile = path.join(combinedWasmDir, 'versions');
+  if (!fs.existsSync(versionsFile)) {
+    console.error(`Combined build not found at ${combinedWasmDir}`);
+    console.error('Please build it first with: cd parser && npm run combined:build');
+    process.exit(1);
+  }
+  const combinedVersions = fs.readFileSync(versionsFile, 'utf8').trim().split(/\s+/);
+  const missing = config.versions.filter(v => !combinedVersions.includes(v));
+  if (missing.length > 0) {
+    console.error(`The combined build holds ${combinedVersions.join(', ')}, not ${missing.join(', ')}`);
+    console.error(`Rebuild it with VERSIONS="${config.versions.join(' ')}"`);
+    process.exit(1);
+  }
+}
+
 console.log(`Building parser package: ${buildType}`);
 console.log(`Description: ${config.description}`);
 console.log(`Versions: ${config.versions.join(', ')}`);
+console.log(`Combined binary: ${combined ? 'yes' : 'no'}`);
 console.log('');
 
 // Ensure wasm directory exists
@@ -66,6 +88,7 @@ function generateTemplateVars(versions) {
   const versionNodeMap = versions.map(v => `  ${v}: Node${v};`).join('\n');
   
   return {
+    COMBINED: String(combined),
     DEFAULT_VERSION: defaultVersion,
     VERSIONS: versionsArray,
     VERSION_UNION: versionUnion,
@@ -112,6 +135,20 @@ config.versions.forEach(version => {
   // Copy all files from source wasm directory
   const files = fs.readdirSync(sourceWasmDir);
   files.forEach(file => {
+    // The combined binary stands in for each version's own (see
+    // ../combined/loader.cjs)
+    if (combined && file === 'libpg-query.wasm') {
+      return;
+    }
+    if (combined && file === 'libpg-query.js') {
+      console.log(`Writing combined loader stub for v${version}...`);
+      fs.writeFileSync(
+        path.join(versionWasmDir, file),
+        `// Runs PostgreSQL ${version} on the combined binary in ../combined\n` +
+        `module.exports = require('../combined/loader.cjs').forVersion(${version});\n`
+      );
+      return;
+    }
     const sourcePath = path.join(sourceWasmDir, file);
     const destPath = path.join(versionWasmDir, file);
     
@@ -154,6 +191,18 @@ config.versions.forEach(version => {
   }
 });
 
+// Copy the combined binary, its Emscripten loader and the loader the versions share
+if (combined) {
+  const combinedDir = path.join(wasmDir, 'combined');
+  fs.mkdirSync(combinedDir, { recursive: true });
+  for (const file of ['libpg-query.js', 'libpg-query.wasm']) {
+    console.log(`Copying combined/${file}...`);
+    fs.copyFileSync(path.join(combinedWasmDir, file), path.join(combinedDir, file));
+  }
+  console.log('Copying combined/loader.cjs...');
+  fs.copyFileSync(path.join(__dirname, '../combined/loader.cjs'), path.join(combinedDir, 'loader.cjs'));
+}
+
 // Generate files from templates
 const templateDir = path.join(__dirname, '../templates');
 const templateVars = generateTemplateVars(config.versions);
@@ -201,6 +250,7 @@ export * from './v${version}/index';
 const buildInfo = {
   buildType,
   versions: config.versions,
+  combined,
   description: config.description,
   buildTime: new Date().toISOString()
 };
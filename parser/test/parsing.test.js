@@ -1,6 +1,6 @@
 const { describe, it, before } = require('node:test');
 const assert = require('node:assert/strict');
-const { Parser } = require('../wasm/index.cjs');
+const { Parser, ParserPool } = require('../wasm/index.cjs');
 
 describe('Parser', () => {
   describe('Dynamic API', () => {
@@ -69,6 +69,116 @@ describe('Parser', () => {
     });
   });
 
+  describe('ParserPool', () => {
+    it('should parse on worker threads like Parser', async () => {
+      const parser = new Parser();
+      const pool = new ParserPool({ size: 2 });
+      try {
+        const queries = ['SELECT 1', 'SELECT * FROM users', 'SELECT 2+2 as sum'];
+        const results = await Promise.all(queries.map(q => pool.parse(q)));
+        for (let i = 0; i < queries.length; i++) {
+          assert.deepEqual(results[i], await parser.parse(queries[i]));
+        }
+        const inline = await parser.parse('INVALID SQL').catch((error) => error);
+        await assert.rejects(pool.parse('INVALID SQL'), (error) => {
+          assert.equal(error.name, 'SqlError');
+          assert.ok(error instanceof inline.constructor);
+          assert.deepEqual(error.sqlDetails, inline.sqlDetails);
+          return true;
+        });
+      } finally {
+        await pool.destroy();
+      }
+    });
+  });
+
+  describe('Compiled module sharing', () => {
+    it('should hand out the compiled module and accept it back', async () => {
+      const wasmModule = await new Parser({ version: 17 }).getCompiledModule();
+      assert.ok(wasmModule instanceof WebAssembly.Module);
+
+      const parser = new Parser({ version: 17, wasmModule });
+      const result = await parser.parse('SELECT 1');
+      assert.equal(result.stmts.length, 1);
+    });
+
+    it('should run every version on the one binary in the combined build', async (t) => {
+      if (!require('../wasm/build-info.json').combined) {
+        t.skip('not a combined build');
+        return;
+      }
+      const parsers = [new Parser({ version: 16 }), new Parser({ version: 17 })];
+      const [compiled16, compiled17] = await Promise.all(parsers.map(p => p.getCompiledModule()));
+      assert.equal(compiled16, compiled17);
+
+      for (const parser of parsers) {
+        const result = await parser.parse('SELECT 1');
+        assert.equal(Math.floor(result.version / 10000), parser.version);
+      }
+    });
+  });
+
+  describe('Parse cache', () => {
+    it('should return the same frozen tree for repeated queries', async () => {
+      const parser = new Parser({ cache: { maxBytes: 1024 * 1024 } });
+      const first = await parser.parse('SELECT * FROM users');
+      const second = parser.parseSync('SELECT * FROM users');
+      assert.equal(first, second);
+      assert.ok(Object.isFrozen(first.stmts[0].stmt));
+      const stats = parser.getCacheStats();
+      assert.equal(stats.hits, 1);
+      assert.equal(stats.misses, 1);
+      assert.equal(stats.entries, 1);
+      assert.ok(stats.bytes > 0);
+    });
+
+    it('should evict least recently used trees beyond maxBytes', async () => {
+      const parser = new Parser({ cache: { maxBytes: 4096 } });
+      for (let i = 0; i < 50; i++) {
+        await parser.parse(`SELECT ${i} FROM users`);
+      }
+      const stats = parser.getCacheStats();
+      assert.ok(stats.bytes <= 4096);
+      assert.ok(stats.evictions > 0);
+    });
+
+    it('should neither store nor freeze trees larger than maxBytes', async () => {
+      const parser = new Parser({ cache: { maxBytes: 256 } });
+      const result = await parser.parse('SELECT a, b, c, d, e, f FROM users WHERE id = 1');
+      assert.ok(!Object.isFrozen(result));
+      assert.equal(parser.getCacheStats().entries, 0);
+    });
+
+    it('should be disabled by default', () => {
+      assert.equal(new Parser().getCacheStats(), null);
+    });
+  });
+
+  describe('Parse stats', () => {
+    it('should count calls, errors and durations', async () => {
+      const samples = [];
+      const parser = new Parser({ stats: { onCall: (sample) => samples.push(sample) } });
+      await parser.parse('SELECT 1');
+      await assert.rejects(() => parser.parse('SELECT * FROM users WHERE id = @'));
+      parser.parseSync('SELECT 2');
+
+      const stats = parser.getStats();
+      assert.equal(stats.operations.parse.calls, 2);
+      assert.equal(stats.operations.parse.errors, 1);
+      assert.equal(stats.operations.parse.bytesIn, 'SELECT 1'.length + 'SELECT * FROM users WHERE id = @'.length);
+      assert.equal(stats.operations.parseSync.calls, 1);
+      assert.equal(stats.operations.parseSync.totalMs.buckets[stats.bucketsMs.length - 1], 1);
+      assert.deepEqual(samples.map(sample => sample.error), [false, true, false]);
+
+      parser.resetStats();
+      assert.deepEqual(parser.getStats().operations, {});
+    });
+
+    it('should be disabled by default', () => {
+      assert.equal(new Parser().getStats(), null);
+    });
+  });
+
   describe('Version-specific imports', () => {
     // Dynamically test available version imports
     const versions = [13, 14, 15, 16, 17];
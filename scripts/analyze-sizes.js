@@ -12,6 +12,10 @@ function formatBytes(bytes, decimals = 2) {
   return parseFloat((bytes / Math.pow(k, i)).toFixed(dm)) + ' ' + sizes[i];
 }
 
+function formatSignedBytes(bytes) {
+  return (bytes < 0 ? '-' : '') + formatBytes(Math.abs(bytes));
+}
+
 // Helper to get file size
 function getFileSize(filePath) {
   try {
@@ -33,8 +37,7 @@ function getGzippedSize(filePath) {
 }
 
 // Analyze a package
-function analyzePackage(packagePath, packageName) {
-  const wasmPath = path.join(packagePath, 'wasm');
+function analyzePackage(packagePath, packageName, wasmPath = path.join(packagePath, 'wasm')) {
   const files = {
     'WASM Binary': 'libpg-query.wasm',
     'WASM Loader': 'libpg-query.js',
@@ -71,6 +74,31 @@ function analyzePackage(packagePath, packageName) {
   return results;
 }
 
+// Measures the combined multi-version binary from parser/combined against the
+// per-version binaries of the versions it holds
+function analyzeCombined() {
+  const combinedDir = './parser/combined/wasm';
+  const versionsFile = path.join(combinedDir, 'versions');
+  if (!fs.existsSync(versionsFile)) {
+    return null;
+  }
+
+  const separate = fs.readFileSync(versionsFile, 'utf8').trim().split(/\s+/).map(version => {
+    const wasmFile = path.join('./versions', version, 'wasm', 'libpg-query.wasm');
+    return { version, size: getFileSize(wasmFile), gzipped: getGzippedSize(wasmFile) };
+  });
+  const combinedFile = path.join(combinedDir, 'libpg-query.wasm');
+
+  return {
+    separate,
+    missing: separate.filter(v => v.size === 0).map(v => v.version),
+    separateSize: separate.reduce((sum, v) => sum + v.size, 0),
+    separateGzipped: separate.reduce((sum, v) => sum + v.gzipped, 0),
+    combinedSize: getFileSize(combinedFile),
+    combinedGzipped: getGzippedSize(combinedFile)
+  };
+}
+
 // Get all version packages dynamically
 function getVersionPackages() {
   const versionsDir = './versions';
@@ -78,6 +106,14 @@ function getVersionPackages() {
     { path: './full', name: 'full (Full)', version: 'original' }
   ];
 
+  // Build profiles (PROFILE=speed|simd|size in the Makefile) land in full/wasm/<profile>/
+  for (const profile of ['speed', 'simd', 'size']) {
+    const wasmPath = path.join('./full/wasm', profile);
+    if (fs.existsSync(path.join(wasmPath, 'libpg-query.wasm'))) {
+      packages.push({ path: './full', wasmPath, name: `full (${profile})`, version: `original-${profile}` });
+    }
+  }
+
   if (fs.existsSync(versionsDir)) {
     const versions = fs.readdirSync(versionsDir)
       .filter(dir => fs.statSync(path.join(versionsDir, dir)).isDirectory())
@@ -102,7 +138,7 @@ function getVersionPackages() {
 // Main analysis
 function analyze() {
   const packages = getVersionPackages();
-  const results = packages.map(pkg => analyzePackage(pkg.path, pkg.name));
+  const results = packages.map(pkg => analyzePackage(pkg.path, pkg.name, pkg.wasmPath));
 
   // Generate markdown report
   let markdown = `# Build Size Analysis Report
@@ -173,6 +209,28 @@ Generated on: ${new Date().toISOString()}
     });
   }
 
+  const combined = analyzeCombined();
+  markdown += `\n## Multi-version Layout\n\n`;
+  if (!combined) {
+    markdown += `No combined binary found. Build it with \`pnpm --filter @pgsql/parser combined:build\` to measure it against the per-version binaries.\n`;
+  } else if (combined.missing.length > 0) {
+    markdown += `The combined binary holds PostgreSQL ${combined.separate.map(v => v.version).join(', ')}, but the per-version binaries for ${combined.missing.join(', ')} are not built, so there is nothing to compare it with.\n`;
+  } else {
+    markdown += `The combined binary from \`parser/combined\` against the per-version binaries it replaces in \`@pgsql/parser\`, both measured.\n\n`;
+    markdown += `| Layout | WASM Size | Gzipped |\n`;
+    markdown += `|--------|-----------|---------|\n`;
+
+    combined.separate.forEach(v => {
+      markdown += `| PostgreSQL ${v.version} | ${formatBytes(v.size)} | ${formatBytes(v.gzipped)} |\n`;
+    });
+
+    const savedSize = combined.separateSize - combined.combinedSize;
+    const savedGzipped = combined.separateGzipped - combined.combinedGzipped;
+    markdown += `| Separate per-version binaries | ${formatBytes(combined.separateSize)} | ${formatBytes(combined.separateGzipped)} |\n`;
+    markdown += `| Combined binary | ${formatBytes(combined.combinedSize)} | ${formatBytes(combined.combinedGzipped)} |\n`;
+    markdown += `| Savings | ${formatSignedBytes(savedSize)} (${(savedSize / combined.separateSize * 100).toFixed(1)}%) | ${formatSignedBytes(savedGzipped)} (${(savedGzipped / combined.separateGzipped * 100).toFixed(1)}%) |\n`;
+  }
+
   markdown += `\n## Notes\n\n`;
   markdown += `- Gzipped sizes represent the approximate size when served with compression\n`;
   markdown += `- The WASM binary is the largest component and is shared across all API methods\n`;
@@ -15,6 +15,12 @@ export interface SqlErrorDetails {
   context?: string;        // Additional context
 }
 
+// Per-query entry returned by parseBatch/parseBatchSync
+export interface ParseBatchItem {
+  result?: any;            // Parse tree when the query parsed successfully
+  error?: Error;           // SqlError (or input validation error) otherwise
+}
+
 // Options for formatting SQL errors
 export interface SqlErrorFormatOptions {
   showPosition?: boolean;  // Show the error position marker (default: true)
@@ -124,23 +130,124 @@ export function hasSqlDetails(error: any): error is Error & { sqlDetails: SqlErr
          'cursorPosition' in (error as any).sqlDetails;
 }
 
-const initPromise = PgQueryModule().then((module: any) => {
-  wasmModule = module;
-});
+export interface LoadModuleOptions {
+  // A compiled libpg-query.wasm, e.g. from getCompiledModule() on another thread
+  wasmModule?: WebAssembly.Module;
+}
+
+// The compiled libpg-query.wasm, handed out by getCompiledModule()
+let compiledWasm: WebAssembly.Module | null = null;
+let compilePromise: Promise<WebAssembly.Module | null> | null = null;
+
+// URL of this file in the ES module build, where scripts/build.js sets it to
+// import.meta.url; the CommonJS build has __dirname instead
+const ESM_MODULE_URL: string | undefined = undefined;
+
+// Compiles libpg-query.wasm, which sits next to this file, so the compiled
+// module can be kept without Emscripten having to expose it. Returns null
+// where the binary cannot be located; Emscripten then loads it itself.
+async function compileWasm(): Promise<WebAssembly.Module | null> {
+  // A loader that runs on another binary, such as the combined multi-version
+  // build in @pgsql/parser, compiles that binary itself
+  if (typeof PgQueryModule.compileWasm === 'function') {
+    return PgQueryModule.compileWasm();
+  }
+  const isNode = typeof process !== 'undefined' && !!process.versions?.node;
+  if (isNode && typeof __dirname !== 'undefined' && typeof require === 'function') {
+    const { readFile } = require('fs/promises');
+    return WebAssembly.compile(await readFile(require('path').join(__dirname, 'libpg-query.wasm')));
+  }
+  if (!ESM_MODULE_URL) {
+    return null;
+  }
+  const url = new URL('libpg-query.wasm', ESM_MODULE_URL);
+  if (isNode && url.protocol === 'file:') {
+    const { readFile } = await import(/* webpackIgnore: true */ 'fs/promises');
+    return WebAssembly.compile(await readFile(url));
+  }
+  const response = await fetch(url);
+  if (!response.ok) {
+    throw new Error(`Failed to fetch ${url}: ${response.status}`);
+  }
+  return WebAssembly.compile(await response.arrayBuffer());
+}
+
+function getCompiledWasm(): Promise<WebAssembly.Module | null> {
+  if (compiledWasm) {
+    return Promise.resolve(compiledWasm);
+  }
+  compilePromise ??= compileWasm().then(
+    (module) => (compiledWasm ??= module),
+    (error) => {
+      compilePromise = null;
+      throw error;
+    }
+  );
+  return compilePromise;
+}
+
+async function instantiateModule(): Promise<any> {
+  const compiled = await getCompiledWasm();
+  if (!compiled) {
+    return PgQueryModule();
+  }
+  return new Promise((resolve, reject) => {
+    PgQueryModule({
+      instantiateWasm(
+        imports: WebAssembly.Imports,
+        receiveInstance: (instance: WebAssembly.Instance, module: WebAssembly.Module) => void
+      ) {
+        WebAssembly.instantiate(compiled, imports).then(
+          (instance) => receiveInstance(instance, compiled),
+          reject
+        );
+        return {};
+      }
+    }).then(resolve, reject);
+  });
+}
+
+let initPromise: Promise<void> | null = null;
+
+// The module is instantiated on first use rather than on import, so that a
+// compiled module passed to loadModule() is used before anything is compiled
+function init(options: LoadModuleOptions = {}): Promise<void> {
+  if (!initPromise) {
+    if (options.wasmModule) {
+      compiledWasm = options.wasmModule;
+    }
+    initPromise = instantiateModule().then((module: any) => {
+      wasmModule = module;
+    });
+    // Let a failed load be retried
+    initPromise.catch(() => {
+      initPromise = null;
+    });
+  }
+  return initPromise;
+}
 
 function ensureLoaded() {
   if (!wasmModule) throw new Error("WASM module not initialized. Call `loadModule()` first.");
 }
 
-export async function loadModule() {
+export async function loadModule(options?: LoadModuleOptions) {
   if (!wasmModule) {
-    await initPromise;
+    await init(options);
   }
 }
 
+// Returns the compiled libpg-query.wasm, to pass to loadModule({ wasmModule })
+// in a worker so that it does not compile the binary again. Null where the
+// binary could not be located and Emscripten loaded it itself.
+export async function getCompiledModule(): Promise<WebAssembly.Module> {
+  await init();
+  return compiledWasm;
+}
+
 function awaitInit<T extends (...args: any[]) => any>(fn: T): T {
   return (async (...args: Parameters<T>) => {
-    await initPromise;
+    await init();
     return fn(...args);
   }) as T;
 }
@@ -305,4 +412,97 @@ export function parseSync(query: string) {
       wasmModule._wasm_free_parse_result(resultPtr);
     }
   }
-}
\ No newline at end of file
+}
+
+// Read a PgQueryError struct into a SqlError
+// struct { char* message; char* funcname; char* filename; int lineno; int cursorpos; char* context; }
+function readSqlError(errorPtr: number): SqlError {
+  const messagePtr = wasmModule.getValue(errorPtr, 'i32');           // offset 0
+  const funcnamePtr = wasmModule.getValue(errorPtr + 4, 'i32');      // offset 4
+  const filenamePtr = wasmModule.getValue(errorPtr + 8, 'i32');      // offset 8
+  const lineno = wasmModule.getValue(errorPtr + 12, 'i32');          // offset 12
+  const cursorpos = wasmModule.getValue(errorPtr + 16, 'i32');       // offset 16
+  const contextPtr = wasmModule.getValue(errorPtr + 20, 'i32');      // offset 20
+
+  const message = messagePtr ? wasmModule.UTF8ToString(messagePtr) : 'Unknown error';
+  const filename = filenamePtr ? wasmModule.UTF8ToString(filenamePtr) : null;
+
+  return new SqlError(message, {
+    message: message,
+    cursorPosition: cursorpos > 0 ? cursorpos - 1 : 0, // Convert to 0-based
+    fileName: filename || undefined,
+    functionName: funcnamePtr ? wasmModule.UTF8ToString(funcnamePtr) : undefined,
+    lineNumber: lineno > 0 ? lineno : undefined,
+    context: contextPtr ? wasmModule.UTF8ToString(contextPtr) : undefined
+  });
+}
+
+// sizeof(PgQueryParseResult) on wasm32
+const PARSE_RESULT_SIZE = 12;
+
+export const parseBatch = awaitInit(async (queries: string[]) => {
+  return parseBatchSync(queries);
+});
+
+export function parseBatchSync(queries: string[]): ParseBatchItem[] {
+  if (!Array.isArray(queries)) {
+    throw new TypeError(`Expected an array of strings, got ${typeof queries}`);
+  }
+
+  const items: ParseBatchItem[] = new Array(queries.length);
+  if (queries.length === 0) {
+    return items;
+  }
+
+  // Invalid entries get their error up front and are packed as empty strings,
+  // so every query keeps its slot in the NUL-separated input buffer
+  const inputs = queries.map((query, i) => {
+    if (typeof query !== 'string') {
+      throw new TypeError(`Expected a string at index ${i}, got ${typeof query}`);
+    }
+    if (query.trim() === '') {
+      items[i] = { error: new Error('Query cannot be empty') };
+      return '';
+    }
+    if (query.includes('\0')) {
+      items[i] = { error: new Error('Query cannot contain NUL characters') };
+      return '';
+    }
+    return query;
+  });
+
+  const queriesPtr = stringToPtr(inputs.join('\0'));
+  let resultsPtr = 0;
+
+  try {
+    // One call parses the whole batch and returns an array of result structs
+    resultsPtr = wasmModule._wasm_parse_batch(queriesPtr, queries.length);
+    if (!resultsPtr) {
+      throw new Error('Failed to allocate memory for batch parse result');
+    }
+
+    for (let i = 0; i < queries.length; i++) {
+      if (items[i]) continue;
+
+      const resultPtr = resultsPtr + i * PARSE_RESULT_SIZE;
+      const parseTreePtr = wasmModule.getValue(resultPtr, 'i32');      // offset 0
+      const errorPtr = wasmModule.getValue(resultPtr + 8, 'i32');        // offset 8
+
+      if (errorPtr) {
+        items[i] = { error: readSqlError(errorPtr) };
+      } else if (!parseTreePtr) {
+        items[i] = { error: new Error('Parse result is null') };
+      } else {
+        items[i] = { result: JSON.parse(wasmModule.UTF8ToString(parseTreePtr)) };
+      }
+    }
+
+    return items;
+  }
+  finally {
+    wasmModule._free(queriesPtr);
+    if (resultsPtr) {
+      wasmModule._wasm_free_parse_batch(resultsPtr, queries.length);
+    }
+  }
+}
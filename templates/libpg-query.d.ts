@@ -10,6 +10,17 @@ declare module './libpg-query.js' {
     HEAPU8: Uint8Array;
   }
 
-  const PgQueryModule: () => Promise<WasmModule>;
+  interface ModuleOptions {
+    instantiateWasm?: (
+      imports: WebAssembly.Imports,
+      receiveInstance: (instance: WebAssembly.Instance, module: WebAssembly.Module) => void
+    ) => {};
+  }
+
+  const PgQueryModule: {
+    (options?: ModuleOptions): Promise<WasmModule>;
+    // Set by loaders that run on another binary (see compileWasm in index.ts)
+    compileWasm?: () => Promise<WebAssembly.Module | null>;
+  };
   export default PgQueryModule;
 } 
\ No newline at end of file
@@ -44,4 +44,36 @@ void wasm_free_parse_result(PgQueryParseResult* result) {
         pg_query_free_parse_result(*result);
         free(result);
     }
+}
+
+// Batch parse: `inputs` holds `count` NUL-separated queries packed back to back.
+// Returns an array of `count` PgQueryParseResult structs in input order.
+EMSCRIPTEN_KEEPALIVE
+PgQueryParseResult* wasm_parse_batch(const char* inputs, int count) {
+    if (!inputs || count <= 0) {
+        return NULL;
+    }
+
+    PgQueryParseResult* results = (PgQueryParseResult*)safe_malloc(sizeof(PgQueryParseResult) * count);
+    if (!results) {
+        return NULL;
+    }
+
+    const char* input = inputs;
+    for (int i = 0; i < count; i++) {
+        results[i] = pg_query_parse(input);
+        input += strlen(input) + 1;
+    }
+
+    return results;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_free_parse_batch(PgQueryParseResult* results, int count) {
+    if (results) {
+        for (int i = 0; i < count; i++) {
+            pg_query_free_parse_result(results[i]);
+        }
+        free(results);
+    }
 }
\ No newline at end of file
@@ -24,11 +24,15 @@ fs.renameSync(
   path.join(wasmDir, 'index.cjs')
 );
 
-// Rename ESM files
-fs.renameSync(
-  path.join(esmDir, 'index.js'),
-  path.join(wasmDir, 'index.js')
-);
+// Rename ESM files, giving the ES module build the URL it locates
+// libpg-query.wasm by (see compileWasm in src/index.ts)
+const esmSource = fs.readFileSync(path.join(esmDir, 'index.js'), 'utf8');
+const esmModuleUrl = 'const ESM_MODULE_URL = undefined;';
+if (!esmSource.includes(esmModuleUrl)) {
+  throw new Error(`${esmModuleUrl} not found in the ES module build`);
+}
+fs.writeFileSync(path.join(wasmDir, 'index.js'), esmSource.replace(esmModuleUrl, 'const ESM_MODULE_URL = import.meta.url;'));
+fs.unlinkSync(path.join(esmDir, 'index.js'));
 
 // Rename declaration files
 fs.renameSync(